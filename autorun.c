@@ -6,8 +6,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/prctl.h>
+#include <time.h>
 #include <unistd.h>
 
+#include "biomegen.h"
+
 
 // Main Function
 
@@ -23,28 +26,15 @@ int main() {
 
     printf("\n");
 
-    // Getting Program Version
-
-    char file_line[29];
-    FILE *fptr = fopen("README.md", "r");
-    fgets(file_line, 29, fptr);
-    fgets(file_line, 29, fptr);
-    fgets(file_line, 29, fptr);
-    fclose(fptr);
-
-    char version[12];
-    strncpy(version, file_line + 12, 12);
-    version[strlen(version) - 2] = '\0';
-
-    // Compiling Main Program
+    // Creating Map Context
+    // Maps are generated by the library, reusing the context's memory for every rep
 
-    if (!access("main", F_OK) == 0) {
-        system("gcc -D_GNU_SOURCE main.c -o main -lm -lpng");
-    }
+    MapContext context;
+    init_context(&context);
 
     // Opening Autorun Tasks
 
-    fptr = fopen("autorun_tasks.txt", "r");
+    FILE *fptr = fopen("autorun_tasks.txt", "r");
     char raw_line[256]; // Max task length is 256 chars
 
     while (fgets(raw_line, 256, fptr)) {
@@ -76,15 +66,24 @@ int main() {
 
         printf("Running task \"%s\" for %d reps.\n", inputs, reps);
 
-        // Prepping Save Path
+        // Getting Map Config
+        // Inputs are the main program's arguments, e.g. "1920 1080 100 120 50 5 8 file.png"
 
-        if (save_png) {
-            const int len_inputs = strlen(inputs);
-            char inputs_copy[257];
-            strncpy(inputs_copy, inputs, len_inputs - 4);
-            snprintf(inputs, len_inputs + 3, "%s0.png", inputs_copy);
-        }
-        // "1920 1080 100 120 50 5 8 file.png" --> "1920 1080 100 120 50 5 8 file0.png"
+        MapConfig config;
+        int island_size;
+        char file_path[229];
+        sscanf(
+            inputs, "%d %d %d %d %d %d %d %228[^\n]",
+            &config.width, &config.height, &config.map_resolution, &config.island_abundance,
+            &island_size, &config.coastline_smoothing, &config.processes, file_path
+        );
+        config.island_size = island_size / 10.0;
+        config.distribution = DISTRIBUTION_UNIFORM;
+        config.smoothing_method = SMOOTHING_NEAREST;
+        config.smoothing_passes = 1;
+        const int width = config.width;
+        const int height = config.height;
+        const int processes = config.processes;
 
         // Running Repetitions
 
@@ -99,32 +98,37 @@ int main() {
         float rep_times[reps];
         for (int i = 0; i < reps; i++) {
 
-            if (save_png) {
-
-                // Preparing Rep's Save Path
-
-                const int len_inputs = strlen(inputs);
-                char inputs_copy[257] = "";
-                strncpy(inputs_copy, inputs, len_inputs - 5);
-                snprintf(inputs, len_inputs + 4, "%s%d.png", inputs_copy, i + 1);
-                // Rep 1 is saved in file1.png, rep2 in file2.png, etc.
-
-            }
+            // Generating Map
 
-            // Running Program and Collecting Output
+            config.seed = time(NULL) + i;
 
-            char output[13];
-            char buffer[13]; // max time 99999.999999 seconds (> 27 hours)
+            struct timespec start_time, end_time;
+            clock_gettime(CLOCK_REALTIME, &start_time);
+            MapImage image;
+            generate_map(&context, &config, FORMAT_PNG, false, NULL, &image);
 
-            char command[266] = "./main ";
-            strncat(command, inputs, 256);
+            // Saving Png
+            // Timed with the map, as the main program's time includes writing its output
 
-            FILE *fp = popen(command, "r");
-            fgets(buffer, 13, fp);
-            strncpy(output, buffer, 13);
-            pclose(fp);
+            char rep_path[240];
+            if (save_png) {
+                // Rep 1 is saved in file1.png, rep2 in file2.png, etc.
+                const int len_stem = strlen(file_path) - 4; // Without ".png"
+                snprintf(rep_path, 240, "%.*s%d.png", len_stem, file_path, i + 1);
+            } else {
+                // Overwritten by each rep, and deleted after the last
+                strncpy(rep_path, file_path, 240);
+            }
+            FILE *fptr_png = fopen(rep_path, "w");
+            if (fptr_png != NULL) {
+                fwrite(image.data, 1, image.size, fptr_png);
+                fclose(fptr_png);
+            }
+            free_image(&image);
 
-            float time = atof(output);
+            clock_gettime(CLOCK_REALTIME, &end_time);
+            float time = (float)(end_time.tv_sec - start_time.tv_sec) +
+                (end_time.tv_nsec - start_time.tv_nsec) / 1000000000.0;
             rep_times[i] = time;
 
             // Print Rep Time or Progress Bar
@@ -154,19 +158,7 @@ int main() {
 
         }
 
-        int width = atoi(strtok(inputs, " "));
-        int height = atoi(strtok(NULL, " "));
-        strtok(NULL, " ");
-        strtok(NULL, " ");
-        strtok(NULL, " ");
-        strtok(NULL, " ");
-        int processes = atoi(strtok(NULL, " "));
-
-        // Delete Png File if not Saving
-
         if (!save_png) {
-            char file_path[229];
-            strncpy(file_path, strtok(NULL, ""), 229);
             remove(file_path);
         }
 
@@ -203,7 +195,7 @@ int main() {
         FILE *fptr_results = fopen("autorun_results.csv", "a");
         fprintf(
             fptr_results, "%s, %d, %d, %d, %d, %f, %f, %d",
-            version, width, height, processes, reps, mean, std_deviation, pix_per_sec
+            VERSION, width, height, processes, reps, mean, std_deviation, pix_per_sec
         );
 
         if (reps >= 10) {
@@ -311,6 +303,8 @@ int main() {
 
     fclose(fptr);
 
+    free_context(&context);
+
     return 0;
 
 }
\ No newline at end of file
@@ -0,0 +1,5001 @@
+/*
+Copyright (C) 2025 Liam Ralph
+https://github.com/liam-ralph
+
+This program, including this file, is licensed under the
+GNU General Public License v3.0 (GNU GPLv3), with one exception.
+See LICENSE or this project's source for more information.
+Project Source: https://github.com/liam-ralph/biomegen
+
+result.png, the output of this program, is licensed under The Unlicense.
+See LICENSE_PNG or this project's source for more information.
+
+The BiomeGen library, which generates maps for the BiomeGen terminal
+application (main.c), or any other program (see biomegen.h).
+*/
+
+
+// Includes
+
+#define _POSIX_C_SOURCE 199309L // Needed for CLOCK_REALTIME
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <math.h>
+#include <png.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "biomegen.h"
+
+
+// Structs
+
+typedef struct Node {
+    int coord[2];
+    int index;
+    char type; // Only set in labelled trees (see label_recursive)
+    char labels;
+    struct Node *left;
+    struct Node *right;
+} Node;
+
+typedef struct {
+    int num_bands;
+    int band_height; // Rows per band, the last band may be shorter
+    size_t slot_size; // Bytes per slot
+    int num_slots;
+    _Atomic int next_band; // Next band to be claimed by a worker
+    _Atomic int bands_written; // Bands consumed by the encoder, in order
+    _Atomic int *slot_bands; // Band number + 1 ready in each slot, 0 if none
+    unsigned char *slots; // num_slots * slot_size bytes
+} BandRing;
+
+typedef struct {
+    size_t size; // Encoded size, SIZE_MAX if the band couldn't be encoded
+    size_t raw_size; // Size of the filtered rows (png only)
+    unsigned long adler; // Adler-32 of the filtered rows (png only)
+} Segment;
+
+typedef struct {
+    double x; // Pixel coordinates
+    double y;
+    int neighbour; // Dot across the edge to the next vertex, or a map side (< 0)
+} CellVertex;
+
+typedef struct {
+    // Exact coordinates x / d and y / d, in half pixels (see Voronoi Functions)
+    __int128 x;
+    __int128 y;
+    __int128 d; // Always positive
+    int neighbour;
+} ExactVertex;
+
+typedef struct {
+    // Lists used to compute cells (see get_cell), grown as needed
+    long *dists;
+    int *indexes;
+    ExactVertex *cell; // The last cell computed
+    ExactVertex *clipped;
+    int max_neighbours;
+} CellBuffers;
+
+typedef struct {
+    OutputFormat format;
+    bool palette; // Palette png (see fill_color_lut)
+    int width;
+    int height;
+    int bytes_per_pixel;
+    bool to_memory; // Written to memory instead of a file (see render_map)
+    // Streamed formats (png, qoi), bands are written in order by the encoder
+    FILE *fptr;
+    bool to_stdout;
+    char *buffer; // Encoded output in memory, once closed
+    size_t buffer_size;
+    png_structp png_ptr;
+    png_infop info_ptr;
+    unsigned long adler; // Adler-32 of the png image data so far
+    // In-place formats (ppm, raw), rows are written to the file by the workers
+    int fd; // -1 in memory
+    unsigned char *map;
+    size_t map_size;
+    size_t header_size;
+    // Tiles, written by the workers as their rows are done
+    char directory[229];
+    int num_levels; // Level 0 is full size, every level after is half the size
+    unsigned char *level_pixels; // Shared RGB pixels of level 1, if any
+} Output;
+
+typedef struct {
+    // Regular dots in a grid of cells, as summed-area tables (see get_block_sum)
+    int *land_sums;
+    int *water_sums; // Every dot that isn't land
+    int num_cols;
+    int num_rows;
+    int cell_size; // Pixels per side
+} CellCounts;
+
+typedef struct {
+    // Bounds of a dot's smoothing result, kept between passes (see query_reach_recursive)
+    long margin; // Other type's sum of squared distances minus its own type's, at least
+    int same_dist; // Squared distance of the furthest of its nearest dots of its type, at most
+    int opp_dist; // Squared distance of the furthest of its nearest dots of the other type
+} SmoothingReach;
+
+typedef struct {
+    // Land dots minus water dots in a grid of cells, blurred (see blur_box)
+    long *values;
+    int num_cols;
+    int num_rows;
+    int cell_size; // Pixels per side
+} DensityField;
+
+typedef struct {
+    // Squared distances, in cells, to the nearest cell with a land dot (see transform_line)
+    int *dists; // INT_MAX without land
+    int num_cols;
+    int num_rows;
+    int cell_size; // Pixels per side
+} DistanceField;
+
+typedef enum {
+    // Random number streams (see get_random), one for each use
+    RANDOM_PLACEMENT,
+    RANDOM_SHUFFLE,
+    RANDOM_ASSIGNMENT,
+    RANDOM_BIOMES,
+    RANDOM_JITTER
+} RandomStream;
+
+// General Functions
+// (Alphabetical order)
+
+/**
+ * Blur VALUES, a NUM_COLS by NUM_ROWS grid, with a box of RADIUS cells, first
+ * along rows and then along columns. Values past the edges count as zero, and
+ * the box's sum is kept rather than its mean, so the values stay exact. Each
+ * value costs the same for any RADIUS, as boxes are kept as running sums.
+ * BUFFER is used for a row or column at a time.
+ */
+void blur_box(
+    long values[], const int num_cols, const int num_rows, const int radius, long buffer[]
+) {
+
+    // Blur Rows
+
+    for (int row = 0; row < num_rows; row++) {
+        long *row_values = &values[(long)row * num_cols];
+        long sum = 0;
+        for (int col = 0; col < radius && col < num_cols; col++) {
+            sum += row_values[col];
+        }
+        for (int col = 0; col < num_cols; col++) {
+            if (col + radius < num_cols) {
+                sum += row_values[col + radius];
+            }
+            if (col - radius > 0) {
+                sum -= row_values[col - radius - 1];
+            }
+            buffer[col] = sum;
+        }
+        memcpy(row_values, buffer, num_cols * sizeof(long));
+    }
+
+    // Blur Columns
+
+    for (int col = 0; col < num_cols; col++) {
+        long sum = 0;
+        for (int row = 0; row < radius && row < num_rows; row++) {
+            sum += values[(long)row * num_cols + col];
+        }
+        for (int row = 0; row < num_rows; row++) {
+            if (row + radius < num_rows) {
+                sum += values[(long)(row + radius) * num_cols + col];
+            }
+            if (row - radius > 0) {
+                sum -= values[(long)(row - radius - 1) * num_cols + col];
+            }
+            buffer[row] = sum;
+        }
+        for (int row = 0; row < num_rows; row++) {
+            values[(long)row * num_cols + col] = buffer[row];
+        }
+    }
+
+}
+
+/**
+ * Compare regions A and B for qsort, so the largest comes first. Ties go to
+ * the region with the lowest dot, so the order doesn't depend on the workers.
+ */
+int compare_regions(const void *a, const void *b) {
+    const Region *region_a = a;
+    const Region *region_b = b;
+    if (region_a->area != region_b->area) {
+        return (region_a->area < region_b->area) ? 1 : -1;
+    }
+    return region_a->first_dot - region_b->first_dot;
+}
+
+/**
+ * Drop the pages holding LENGTH bytes at START from this process's memory,
+ * once they have been written and won't be needed again soon. START must be in
+ * a file mapping or shared memory, where the data is kept and can be paged back
+ * in, rather than private memory, where it would be lost.
+ */
+void drop_pages(void *start, const size_t length) {
+
+    const size_t page_size = sysconf(_SC_PAGESIZE);
+    const size_t page_start = (size_t)start / page_size * page_size;
+    const size_t page_end = ((size_t)start + length + page_size - 1) / page_size * page_size;
+
+    msync((void *)page_start, page_end - page_start, MS_ASYNC);
+    madvise((void *)page_start, page_end - page_start, MADV_DONTNEED);
+
+}
+
+/**
+ * Fill COLOR_LUT, of length 12 * 20 * 3, with the RGB color of every type index
+ * (see get_type_index) and color variation. A dot's variation is its index in
+ * dots % 20, and shifts each channel by -10 to +9. Values are clamped here, so
+ * pixels can be colored with a single lookup. The 240 entries also make up the
+ * palette of palette images, where a pixel is its entry's index.
+ */
+void fill_color_lut(unsigned char color_lut[]) {
+
+    const int base_colors[12][3] = {
+        {153, 221, 255}, // Ice
+        {0, 0, 255}, // Shallow Water
+        {0, 0, 179}, // Water
+        {0, 0, 128}, // Deep Water
+        {128, 128, 128}, // Rock
+        {255, 185, 109}, // Desert
+        {0, 77, 0}, // Jungle
+        {0, 128, 0}, // Forest
+        {0, 179, 0}, // Plains
+        {152, 251, 152}, // Taiga
+        {245, 245, 245}, // Snow
+        {40, 0, 0} // Unknown type
+    };
+
+    for (int i = 0; i < 12; i++) {
+        for (int ii = 0; ii < 20; ii++) {
+            for (int iii = 0; iii < 3; iii++) {
+                /*
+                Adds slight color variation
+                Every pixel around the same dot has the same variation
+                */
+                int rgb_val = base_colors[i][iii] + ii - 10;
+                if (rgb_val > 255) {
+                    rgb_val = 255;
+                } else if (rgb_val < 0) {
+                    rgb_val = 0;
+                }
+                color_lut[(i * 20 + ii) * 3 + iii] = rgb_val;
+            }
+        }
+    }
+
+}
+
+/**
+ * Return the root of INDEX's set in PARENTS, a union-find forest where every
+ * root is its own parent. Paths are halved along the way, so later calls are
+ * faster.
+ */
+int find_root(int parents[], int index) {
+    while (parents[index] != index) {
+        parents[index] = parents[parents[index]];
+        index = parents[index];
+    }
+    return index;
+}
+
+/**
+ * Return the root of INDEX's set in PARENTS, a union-find forest shared by
+ * workers joining sets at the same time (see join_shared). Paths are halved as
+ * in find_root, which only ever points a dot at one of its ancestors, so it
+ * stays correct while other workers join sets.
+ */
+int find_root_shared(_Atomic int parents[], int index) {
+    while (true) {
+        const int parent = atomic_load(&parents[index]);
+        if (parent == index) {
+            return index;
+        }
+        const int grandparent = atomic_load(&parents[parent]);
+        atomic_store(&parents[index], grandparent);
+        index = grandparent;
+    }
+}
+
+/**
+ * Return the sum of the cells within RADIUS cells of COL, ROW (cut off at the
+ * edges) in a NUM_COLS by NUM_ROWS grid. SUMS is the grid's summed-area table,
+ * of (NUM_COLS + 1) * (NUM_ROWS + 1) entries, where each is the sum of the
+ * cells above and to the left of it.
+ */
+int get_block_sum(
+    const int sums[], const int num_cols, const int num_rows,
+    const int col, const int row, const int radius
+) {
+
+    const int left = (col - radius > 0) ? col - radius : 0;
+    const int top = (row - radius > 0) ? row - radius : 0;
+    const int right = (col + radius + 1 < num_cols) ? col + radius + 1 : num_cols;
+    const int bottom = (row + radius + 1 < num_rows) ? row + radius + 1 : num_rows;
+    const int sums_width = num_cols + 1;
+
+    return sums[bottom * sums_width + right] - sums[top * sums_width + right] -
+        sums[bottom * sums_width + left] + sums[top * sums_width + left];
+
+}
+
+/**
+ * Return the dot distribution named NAME ("uniform" or "jittered"), or -1 for
+ * an unknown name.
+ */
+int get_distribution(const char name[]) {
+    const char names[2][9] = {"uniform", "jittered"};
+    for (int i = 0; i < 2; i++) {
+        if (strcmp(name, names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Return random number COUNTER of STREAM for the map seed SEED, from 0 to
+ * 2^64 - 1. Numbers are drawn by the index of the dot or coordinate they're
+ * for, so the same seed gives the same map no matter which worker draws them,
+ * or how many workers there are.
+ */
+unsigned long get_random(const unsigned int seed, const RandomStream stream, const long counter) {
+
+    /*
+    SplitMix64's state is a counter, and each number is the state after a
+    mixing function, so number COUNTER can be made directly. The starting
+    state is mixed from SEED and STREAM with the same function.
+    */
+    unsigned long value = (unsigned long)seed << 8 | stream;
+    for (int i = 0; i < 2; i++) {
+        value += ((i == 0) ? 1 : counter + 1) * 0x9E3779B97F4A7C15UL;
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9UL;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBUL;
+        value ^= value >> 31;
+    }
+    return value;
+
+}
+
+/**
+ * Return the smoothing method named NAME ("nearest" or "density"), or -1 for
+ * an unknown name.
+ */
+int get_smoothing_method(const char name[]) {
+    const char names[2][8] = {"nearest", "density"};
+    for (int i = 0; i < 2; i++) {
+        if (strcmp(name, names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Return the index of TYPE in the order used for statistics and colors: Ice,
+ * Shallow Water, Water, Deep Water, Rock, Desert, Jungle, Forest, Plains,
+ * Taiga, Snow. Any other type returns 11.
+ */
+int get_type_index(const char type) {
+    const char types[11] = {'I', 's', 'W', 'd', 'R', 'D', 'J', 'F', 'P', 'T', 'S'};
+    for (int i = 0; i < 11; i++) {
+        if (type == types[i]) {
+            return i;
+        }
+    }
+    return 11;
+}
+
+/**
+ * Return the water biome of a water dot LAND_DIST, squared, from the nearest
+ * land dot, and EQUATOR_DIST from the equator, in twentieths of the map's
+ * height. Each biome is found at one range of land distances, so two land
+ * distances giving the same biome give it for every distance between them.
+ */
+char get_water_biome(const long land_dist, const float equator_dist) {
+    if ( // Remember: all land distances are squared for efficiency
+        (land_dist < 35 * 35 && equator_dist > 9) ||
+        (land_dist < 25 * 25 && equator_dist > 8) ||
+        (land_dist < 15 * 15 && equator_dist > 7)
+    ) {
+        return 'I';
+    } else if (land_dist < 18 * 18) {
+        return 's';
+    } else if (land_dist >= 35 * 35) {
+        return 'd';
+    }
+    return 'W';
+}
+
+/**
+ * Return whether TYPE is a land type, before or after biomes are generated.
+ */
+bool is_land_type(const char type) {
+    const int type_index = get_type_index(type);
+    return type == 'L' || type == 'l' || (type_index >= 4 && type_index < 11);
+}
+
+/**
+ * Join the sets of A and B in PARENTS, a union-find forest shared by workers
+ * joining sets at the same time. A root is only pointed at a lower root, with a
+ * compare-and-swap that fails if another worker has pointed it elsewhere since
+ * it was found, in which case the roots are found again. No join is lost, and
+ * no lock is taken.
+ */
+void join_shared(_Atomic int parents[], int a, int b) {
+    while (true) {
+        a = find_root_shared(parents, a);
+        b = find_root_shared(parents, b);
+        if (a == b) {
+            return;
+        }
+        if (a > b) {
+            const int temp = a;
+            a = b;
+            b = temp;
+        }
+        int expected = b;
+        if (atomic_compare_exchange_strong(&parents[b], &expected, a)) {
+            return;
+        }
+    }
+}
+
+/**
+ * Map SIZE bytes of memory shared with forked workers. Buffers of 256 MiB or
+ * more are backed by an unlinked temporary file instead of anonymous memory,
+ * so pages dropped with drop_pages (or by the kernel under memory pressure)
+ * are written out and paged back in when needed, instead of staying resident.
+ * Exits if the memory can't be mapped.
+ */
+void *map_shared(const size_t size) {
+
+    void *map = MAP_FAILED;
+
+    if (size < 256L * 1024 * 1024) {
+        map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    } else {
+        const char *tmp_dir = getenv("TMPDIR");
+        char path[256];
+        snprintf(path, 256, "%s/biomegen-XXXXXX", (tmp_dir != NULL) ? tmp_dir : "/tmp");
+
+        const int fd = mkstemp(path);
+        if (fd != -1) {
+            unlink(path); // Removed once unmapped
+            if (ftruncate(fd, size) == 0) {
+                map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            }
+            close(fd);
+        }
+    }
+
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Couldn't map %zu bytes of shared memory.\n", size);
+        exit(1);
+    }
+
+    return map;
+
+}
+
+/**
+ * Fill ORDER with the indexes of the NUM_DOTS DOTS of a WIDTH by HEIGHT map in
+ * scanline order, by y and then x. Dots are counting sorted by x, then stably
+ * by y, which takes linear time. In lists built in this order, dots on the same
+ * row are next to each other, so a nearest dot search can be bounded by the
+ * previous dot's distance plus the gap between them.
+ */
+void sort_dots(
+    const Dot dots[], const int num_dots, const int width, const int height, int order[]
+) {
+
+    int *x_order = malloc(num_dots * sizeof(int));
+    const int max_size = (width > height) ? width : height;
+    int *starts = malloc((max_size + 1) * sizeof(int)); // Start of each x or y, then the end
+
+    // Sort by X
+
+    memset(starts, 0, (width + 1) * sizeof(int));
+    for (int i = 0; i < num_dots; i++) {
+        starts[dots[i].x + 1]++;
+    }
+    for (int x = 0; x < width; x++) {
+        starts[x + 1] += starts[x];
+    }
+    for (int i = 0; i < num_dots; i++) {
+        x_order[starts[dots[i].x]++] = i;
+    }
+
+    // Sort by Y, Keeping X Order Within Rows
+
+    memset(starts, 0, (height + 1) * sizeof(int));
+    for (int i = 0; i < num_dots; i++) {
+        starts[dots[i].y + 1]++;
+    }
+    for (int y = 0; y < height; y++) {
+        starts[y + 1] += starts[y];
+    }
+    for (int i = 0; i < num_dots; i++) {
+        const int index = x_order[i];
+        order[starts[dots[index].y]++] = index;
+    }
+
+    free(x_order);
+    free(starts);
+
+}
+
+/**
+ * Turn SUMS, the counts of a NUM_COLS by NUM_ROWS grid of cells in all but the
+ * first row and column, into its summed-area table (see get_block_sum).
+ */
+void sum_cells(int sums[], const int num_cols, const int num_rows) {
+    const int sums_width = num_cols + 1;
+    for (int row = 1; row <= num_rows; row++) {
+        for (int col = 1; col <= num_cols; col++) {
+            const int index = row * sums_width + col;
+            sums[index] +=
+                sums[index - 1] + sums[index - sums_width] - sums[index - sums_width - 1];
+        }
+    }
+}
+
+/**
+ * Return the sum of a list of integers.
+ */
+int sum_list_int(const int list[], const int list_len) {
+    int sum = 0;
+    for (int i = 0; i < list_len; i++) {
+        sum += list[i];
+    }
+    return sum;
+}
+
+/**
+ * Return the sum of a list of floats.
+ */
+float sum_list_float(const float list[], const int list_len) {
+    float sum = 0;
+    for (int i = 0; i < list_len; i++) {
+        sum += list[i];
+    }
+    return sum;
+}
+
+/**
+ * Fill DISTS with the squared distance transform of VALUES, a line of LENGTH
+ * values STRIDE apart: each distance is the least of any value plus its squared distance
+ * along the line. VALUES of INT_MAX are left out, and a line of only INT_MAX
+ * stays INT_MAX. Each value is the lowest point of a parabola, and the lower
+ * envelope of the parabolas is found in one pass, with VERTICES and BOUNDS
+ * (LENGTH + 1 long) holding its parabolas and where each starts, then read off
+ * in another, so this takes linear time (Felzenszwalb and Huttenlocher).
+ * Applied to the rows of a grid and then to its columns, it gives exact squared
+ * Euclidean distances.
+ */
+void transform_line(
+    const int values[], const long stride, const int length, int dists[], int vertices[],
+    double bounds[]
+) {
+
+    // Find Lower Envelope
+
+    int num_vertices = 0;
+    for (int i = 0; i < length; i++) {
+        if (values[i * stride] == INT_MAX) {
+            continue;
+        }
+        double bound = -INFINITY;
+        while (num_vertices > 0) {
+            // Where the parabola at i meets the last one of the envelope
+            const int vertex = vertices[num_vertices - 1];
+            bound = (
+                (double)values[i * stride] + (double)i * i -
+                values[vertex * stride] - (double)vertex * vertex
+            ) / (2.0 * (i - vertex));
+            if (bound > bounds[num_vertices - 1]) {
+                break;
+            }
+            // Last parabola is under the new one nowhere
+            num_vertices--;
+            bound = -INFINITY;
+        }
+        vertices[num_vertices] = i;
+        bounds[num_vertices] = bound;
+        num_vertices++;
+    }
+
+    if (num_vertices == 0) {
+        for (int i = 0; i < length; i++) {
+            dists[i] = INT_MAX;
+        }
+        return;
+    }
+
+    // Read Distances Off Envelope
+
+    bounds[num_vertices] = INFINITY;
+    int ii = 0;
+    for (int i = 0; i < length; i++) {
+        while (bounds[ii + 1] < i) {
+            ii++;
+        }
+        const int diff = i - vertices[ii];
+        dists[i] = diff * diff + values[vertices[ii] * stride];
+    }
+
+}
+
+/**
+ * Unmap SIZE bytes at MAP, mapped by map_shared.
+ */
+void unmap_shared(void *map, const size_t size) {
+    munmap(map, size);
+}
+
+
+// KDTree Functions
+
+/**
+ * Return the squared distance DIFF_X**2 + DIFF_Y**2, saturated at INT_MAX.
+ * Distances are squared for efficiency, and would otherwise overflow for
+ * points more than 46340 pixels apart. Queries compute squared distances as
+ * longs instead, and only store them once they are below an int bound.
+ */
+int get_dist_sq(const int diff_x, const int diff_y) {
+    const long dist = (long)diff_x * diff_x + (long)diff_y * diff_y;
+    return (dist < INT_MAX) ? dist : INT_MAX;
+}
+
+/**
+ * Sort the given COORDS until the median index is correctly sorted. In other
+ * words, median index will be correct, everything before median index will be
+ * less than the value at median index, and everything after will be greater.
+ * AXIS determines which value of a coordinate is its value (x or y) to sort
+ * based on. HIGH and LOW determine the sorting bounds for a given level of
+ * recursion.
+ */
+void median_sort_recursive(
+    int *coords, const int low, const int high, const int axis, const int med_index
+) {
+
+    if (low < high) {
+
+        /*
+        Pivot value is the value at coords[high]. Every value less than pivot
+        will be to the left of wherever pivot ends up. Remember: a coord is
+        {x, y, index (of equivalent dot in dots)}. The array isn't 2D as it
+        requires malloc.
+        */
+        int pivot = coords[high * 3 + axis];
+
+        // Move Smaller Elements to the Left
+
+        int i = low - 1;
+
+        for (int ii = low; ii <= high - 1; ii++) {
+            if (coords[ii * 3 + axis] < pivot) {
+                i++;
+                const int temp[3] = {coords[i * 3], coords[i * 3 + 1], coords[i * 3 + 2]};
+                coords[i * 3] = coords[ii * 3];
+                coords[i * 3 + 1] = coords[ii * 3 + 1];
+                coords[i * 3 + 2] = coords[ii * 3 + 2];
+                coords[ii * 3] = temp[0];
+                coords[ii * 3 + 1] = temp[1];
+                coords[ii * 3 + 2] = temp[2];
+            }
+        }
+
+        // Move Pivot to After Smaller Elements
+
+        i++;
+        const int temp[3] = {coords[i * 3], coords[i * 3 + 1], coords[i * 3 + 2]};
+        coords[i * 3] = coords[high * 3];
+        coords[i * 3 + 1] = coords[high * 3 + 1];
+        coords[i * 3 + 2] = coords[high * 3 + 2];
+        coords[high * 3] = temp[0];
+        coords[high * 3 + 1] = temp[1];
+        coords[high * 3 + 2] = temp[2];
+
+        // Decide Whether Recursion is Needed
+        /*
+        Cases:
+        i == med_index, the median is in the correct spot, no more sorting
+        i > med_index, median is in left section, left section needs sorting
+        i < med_index, median in right section, sort right section
+        */
+
+        if (i > med_index) {
+            median_sort_recursive(coords, low, i - 1, axis, med_index);
+        } else if (i < med_index) {
+            median_sort_recursive(coords, i + 1, high, axis, med_index);
+        }
+
+    }
+
+}
+
+/**
+ * Build a KDTree from COORDS, and return the root node. Ensures the KDTree is
+ * built with the lowest possible depth for maximum efficiency when querying the
+ * tree. Every recursion creates one dot and calls this function to insert its
+ * children from an array of possible dots. DEPTH should be 0. COORDS should be
+ * of length NUM_COORDS * 3.
+ */
+Node *build_recursive(int *coords, const int num_coords, const int depth) {
+
+    const int med_pos = num_coords / 2;
+
+    // Sort Coords Around Median Position
+    /*
+    Median coord will be in correct place, everything less will be to the left,
+    everything else to the right.
+    */
+
+    median_sort_recursive(coords, 0, num_coords - 1, depth % 2, med_pos);
+
+    // Add Median Node to Tree
+    // Every recursion adds one node
+
+    Node *node = malloc(sizeof(Node));
+    node->coord[0] = coords[med_pos * 3];
+    node->coord[1] = coords[med_pos * 3 + 1];
+    node->index = coords[med_pos * 3 + 2];
+    node->type = 0;
+    node->labels = 0;
+    node->left = NULL;
+    node->right = NULL;
+
+    // Decide whether node will have a left child
+
+    const int num_coords_left = med_pos;
+
+    if (num_coords_left > 0) {
+
+        int *coords_left = malloc(num_coords_left * 3 * sizeof(int));
+        for (int i = 0; i < med_pos; i++) {
+            coords_left[i * 3] = coords[i * 3];
+            coords_left[i * 3 + 1] = coords[i * 3 + 1];
+            coords_left[i * 3 + 2] = coords[i * 3 + 2];
+        }
+        node->left = build_recursive(coords_left, num_coords_left, depth + 1);
+        free(coords_left);
+
+        // Decide whether node will have a right child
+
+        const int num_coords_right = num_coords - med_pos - 1;
+
+        if (num_coords_right > 0) {
+            int *coords_right = malloc(num_coords_right * 3 * sizeof(int));
+            for (int i = 0; i < num_coords_right; i++) {
+                const int index = i + med_pos + 1;
+                coords_right[i * 3] = coords[index * 3];
+                coords_right[i * 3 + 1] = coords[index * 3 + 1];
+                coords_right[i * 3 + 2] = coords[index * 3 + 2];
+            }
+            node->right = build_recursive(coords_right, num_coords_right, depth + 1);
+            free(coords_right);
+        }
+
+    }
+
+    // Return node to place it within the tree
+    return node;
+
+}
+
+/**
+ * Recursively label NODE and its children with the types of their DOTS, for
+ * query_labelled_recursive. A node's labels have bit 1 set if it or its
+ * children include land, and bit 2 if they include water. Returns NODE's
+ * labels.
+ */
+char label_recursive(Node *node, const Dot dots[]) {
+    node->type = dots[node->index].type;
+    node->labels = (node->type == 'L') ? 1 : 2;
+    if (node->left != NULL) {
+        node->labels |= label_recursive(node->left, dots);
+    }
+    if (node->right != NULL) {
+        node->labels |= label_recursive(node->right, dots);
+    }
+    return node->labels;
+}
+
+/**
+ * Query the KDTree to modify MIN_DIST, the distance to the nearest node. When
+ * INDEX_PTR is not null, it stores the index of the nearest node, which
+ * corresponds to the index of the dot it was created from. Calls itself
+ * recursively to query children of NODE. DEPTH should be 0 when NODE is a root
+ * node.
+ */
+void query_recursive(
+    Node *node, const int coord[2], const int depth, int *index_ptr, int *min_dist_ptr
+) {
+
+    // Calculate Distance
+
+    const int diff_x = node->coord[0] - coord[0];
+    const int diff_y = node->coord[1] - coord[1];
+    // Distance is squared for efficiency
+    const long dist = (long)diff_x * diff_x + (long)diff_y * diff_y;
+
+    // Update Minimum Distance and Index Pointers
+
+    if (dist < *min_dist_ptr) {
+        *min_dist_ptr = dist;
+        if (index_ptr != NULL) {
+            *index_ptr = node->index;
+        } else if (dist < 15 * 15) {
+            return; // Shortcut specifically for water biome generation
+        }
+    }
+
+    // Decide Whether Recursion is Needed
+
+    const int axis = depth % 2;
+
+    const int dist_line = node->coord[axis] - coord[axis];
+    const long dist_sq = (long)dist_line * dist_line;
+    // Whether distance to splitting line is less than max_dist
+    if (node->left != NULL && (dist_sq < *min_dist_ptr || coord[axis] < node->coord[axis])) {
+        /*
+        Recursion only if coord is close enough to dividing line, or coord would
+        be inside bounds of left child
+        */
+        query_recursive(node->left, coord, depth + 1, index_ptr, min_dist_ptr);
+    }
+    if (node->right != NULL && (dist_sq < *min_dist_ptr || coord[axis] >= node->coord[axis])) {
+        query_recursive(node->right, coord, depth + 1, index_ptr, min_dist_ptr);
+    }
+
+}
+
+/**
+ * Query the KDTree like query_recursive, but descend into the child on COORD's
+ * side of the splitting line first, so a tight bound is found as early as
+ * possible. The far child is only visited if it could hold a closer node. Ties
+ * go to the lowest index, so the result doesn't depend on the initial bound or
+ * the order nodes are visited in.
+ */
+void query_near_recursive(
+    Node *node, const int coord[2], const int depth, int *index_ptr, int *min_dist_ptr
+) {
+
+    // Calculate Distance
+
+    const int diff_x = node->coord[0] - coord[0];
+    const int diff_y = node->coord[1] - coord[1];
+    const long dist = (long)diff_x * diff_x + (long)diff_y * diff_y; // Squared distance
+
+    if (dist < *min_dist_ptr || (dist == *min_dist_ptr && node->index < *index_ptr)) {
+        *min_dist_ptr = dist;
+        *index_ptr = node->index;
+    }
+
+    // Decide Whether Recursion is Needed
+
+    const int axis = depth % 2;
+
+    const int dist_line = coord[axis] - node->coord[axis];
+    Node *near = (dist_line < 0) ? node->left : node->right;
+    Node *far = (dist_line < 0) ? node->right : node->left;
+
+    if (near != NULL) {
+        query_near_recursive(near, coord, depth + 1, index_ptr, min_dist_ptr);
+    }
+    if (far != NULL && (long)dist_line * dist_line <= *min_dist_ptr) {
+        query_near_recursive(far, coord, depth + 1, index_ptr, min_dist_ptr);
+    }
+
+}
+
+/**
+ * Query the KDTree rooted at ROOT for the nearest node to COORD, warm started
+ * from SEEDS, the indexes in DOTS of NUM_SEEDS candidate dots (e.g. the nearest
+ * dots to the pixels to the left and above). The exact distance to the closest
+ * seed becomes the initial bound, so descent only leaves that seed's
+ * neighbourhood when a closer node could exist. With NUM_SEEDS of 0 this is a
+ * cold search. MIN_DIST_PTR should be INT_MAX, and INDEX_PTR receives the
+ * index of the nearest dot (the lowest index on ties).
+ */
+void query_seeded(
+    Node *root, const int coord[2], const Dot *dots, const int seeds[], const int num_seeds,
+    int *index_ptr, int *min_dist_ptr
+) {
+
+    // Use Closest Seed as Initial Bound
+
+    for (int i = 0; i < num_seeds; i++) {
+        const Dot *seed = &dots[seeds[i]];
+        const int diff_x = seed->x - coord[0];
+        const int diff_y = seed->y - coord[1];
+        const long dist = (long)diff_x * diff_x + (long)diff_y * diff_y;
+        if (dist < *min_dist_ptr || (dist == *min_dist_ptr && seeds[i] < *index_ptr)) {
+            *min_dist_ptr = dist;
+            *index_ptr = seeds[i];
+        }
+    }
+
+    // Search Only Nodes That Could Beat the Seed
+
+    query_near_recursive(root, coord, 0, index_ptr, min_dist_ptr);
+
+}
+
+/**
+ * Query the labelled KDTree (see label_recursive) for the nearest DISTS_LEN
+ * nodes to COORD of TYPE and of the other type, other than a node at COORD
+ * itself, in one search. DISTS_SAME and DISTS_OPP receive their squared
+ * distances, nearest first, and should start filled with the largest distance
+ * needed of each. The value at SUM_SAME_PTR should start as the sum of
+ * DISTS_SAME, and is kept as it. Other type distances of at least that sum
+ * aren't needed (see smooth_coastlines), so they may be left out. Children are
+ * only searched for the types they include. DEPTH should be 0 when NODE is a
+ * root node.
+ */
+void query_labelled_recursive(
+    Node *node, const int coord[2], const int depth, const char type,
+    int dists_same[], int dists_opp[], const int dists_len, long *sum_same_ptr
+) {
+
+    // Calculate Distance
+
+    const int diff_x = node->coord[0] - coord[0];
+    const int diff_y = node->coord[1] - coord[1];
+    const long dist = (long)diff_x * diff_x + (long)diff_y * diff_y; // Squared distance
+
+    // Update Distances List of Node's Type
+
+    int *dists = (node->type == type) ? dists_same : dists_opp;
+    if (dist < dists[dists_len - 1] && dist != 0) {
+        if (node->type == type) {
+            *sum_same_ptr += dist - dists[dists_len - 1];
+        }
+        int i = dists_len - 1;
+        for (; i > 0 && dist < dists[i - 1]; i--) {
+            dists[i] = dists[i - 1];
+        }
+        dists[i] = dist;
+    }
+
+    // Decide Whether Recursion is Needed
+
+    const int axis = depth % 2;
+    const char same_label = (type == 'L') ? 1 : 2;
+
+    const int dist_line = coord[axis] - node->coord[axis];
+    const long dist_sq = (long)dist_line * dist_line;
+    Node *near = (dist_line < 0) ? node->left : node->right;
+    Node *far = (dist_line < 0) ? node->right : node->left;
+
+    if (near != NULL) {
+        query_labelled_recursive(
+            near, coord, depth + 1, type, dists_same, dists_opp, dists_len, sum_same_ptr
+        );
+    }
+    // Whether the far side could hold a closer node of a type it includes
+    if (far != NULL && (
+        ((far->labels & same_label) && dist_sq < dists_same[dists_len - 1]) ||
+        ((far->labels & ~same_label) && dist_sq < dists_opp[dists_len - 1] &&
+            dist_sq < *sum_same_ptr)
+    )) {
+        query_labelled_recursive(
+            far, coord, depth + 1, type, dists_same, dists_opp, dists_len, sum_same_ptr
+        );
+    }
+
+}
+
+/**
+ * Query the KDTree for the nearest DISTS_LEN nodes to COORD, other than a node
+ * at COORD itself. DISTS and INDEXES receive their squared distances and
+ * indexes, nearest first, and DISTS should start filled with LONG_MAX. Like
+ * query_near_recursive, the child on COORD's side of the splitting line is
+ * visited first. DEPTH should be 0 when NODE is a root node.
+ */
+void query_knn_recursive(
+    Node *node, const int coord[2], const int depth,
+    long dists[], int indexes[], const int dists_len
+) {
+
+    // Calculate Distance
+
+    const int diff_x = node->coord[0] - coord[0];
+    const int diff_y = node->coord[1] - coord[1];
+    const long dist = (long)diff_x * diff_x + (long)diff_y * diff_y; // Squared distance
+
+    // Update Distances and Indexes Lists
+
+    if (dist < dists[dists_len - 1] && dist != 0) {
+        int i = dists_len - 1;
+        for (; i > 0 && dist < dists[i - 1]; i--) {
+            dists[i] = dists[i - 1];
+            indexes[i] = indexes[i - 1];
+        }
+        dists[i] = dist;
+        indexes[i] = node->index;
+    }
+
+    // Decide Whether Recursion is Needed
+
+    const int axis = depth % 2;
+
+    const int dist_line = coord[axis] - node->coord[axis];
+    Node *near = (dist_line < 0) ? node->left : node->right;
+    Node *far = (dist_line < 0) ? node->right : node->left;
+
+    if (near != NULL) {
+        query_knn_recursive(near, coord, depth + 1, dists, indexes, dists_len);
+    }
+    if (far != NULL && (long)dist_line * dist_line < dists[dists_len - 1]) {
+        query_knn_recursive(far, coord, depth + 1, dists, indexes, dists_len);
+    }
+
+}
+
+/**
+ * Query the KDTree, of dots changed from the type of the dot at COORD to the
+ * other, for whether that dot could change type since REACH was found (see
+ * get_smoothing_result). Only the dots within REACH's same_dist of its nearest
+ * dots of its own type matter, so one of them changing gives LONG_MAX, the
+ * value at SUM_PTR is set to. Each other node closer than opp_dist can lower
+ * the other type's sum by at most opp_dist minus its squared distance, which
+ * is added to the value at SUM_PTR. Stops once it's more than REACH's margin.
+ * DEPTH should be 0 when NODE is a root node.
+ */
+void query_reach_recursive(
+    Node *node, const int coord[2], const int depth, const SmoothingReach *reach, long *sum_ptr
+) {
+
+    // Calculate Distance
+
+    const int diff_x = node->coord[0] - coord[0];
+    const int diff_y = node->coord[1] - coord[1];
+    const long dist = (long)diff_x * diff_x + (long)diff_y * diff_y; // Squared distance
+
+    // Update Sum
+
+    if (dist <= reach->same_dist) {
+        *sum_ptr = LONG_MAX;
+    } else if (dist < reach->opp_dist) {
+        *sum_ptr += reach->opp_dist - dist;
+    }
+    if (*sum_ptr > reach->margin) {
+        return;
+    }
+
+    // Decide Whether Recursion is Needed
+
+    const int axis = depth % 2;
+    const long max_dist = (reach->same_dist > reach->opp_dist) ?
+        reach->same_dist : reach->opp_dist;
+
+    const int dist_line = node->coord[axis] - coord[axis];
+    const long dist_sq = (long)dist_line * dist_line;
+    if (node->left != NULL && (dist_sq <= max_dist || coord[axis] < node->coord[axis])) {
+        query_reach_recursive(node->left, coord, depth + 1, reach, sum_ptr);
+    }
+    if (
+        node->right != NULL && *sum_ptr <= reach->margin &&
+        (dist_sq <= max_dist || coord[axis] >= node->coord[axis])
+    ) {
+        query_reach_recursive(node->right, coord, depth + 1, reach, sum_ptr);
+    }
+
+}
+
+/**
+ * Recursively free NODE and its children.
+ */
+void free_recursive(Node *node) {
+    if (node->left != NULL) {
+        free_recursive(node->left);
+    }
+    if (node->right != NULL) {
+        free_recursive(node->right);
+    }
+    free(node);
+    node = NULL;
+}
+
+
+// Voronoi Functions
+/*
+Vector outputs need each dot's Voronoi cell, the area closer to it than to any
+other dot. A cell starts as the whole map, and is clipped by the bisector
+between its dot and each neighbour, nearest first, until no other dot is near
+enough to cut it. Coordinates are in half pixels, with dots at even
+coordinates, so bisectors and map sides are lines with integer coefficients,
+and every vertex is an exact fraction of integers. Clipping decisions are made
+exactly, so two cells always agree on whether they share an edge, which lets
+neighbouring cells be merged without matching up floating point vertices.
+*/
+
+/**
+ * Fill LINE with the coefficients {a, b, c} of the line a*x + b*y = c in half
+ * pixels, for the edge of dot INDEX's cell shared with NEIGHBOUR, the index of
+ * another dot in DOTS, or a side of the WIDTH by HEIGHT map (-1 top, -2 right,
+ * -3 bottom, -4 left). For a dot, a*x + b*y - c is negative on INDEX's side.
+ */
+void get_cell_line(
+    const Dot *dots, const int index, const int neighbour, const int width, const int height,
+    long line[3]
+) {
+
+    if (neighbour >= 0) {
+        const long x_0 = dots[index].x * 2L;
+        const long y_0 = dots[index].y * 2L;
+        const long x_1 = dots[neighbour].x * 2L;
+        const long y_1 = dots[neighbour].y * 2L;
+        line[0] = 2 * (x_1 - x_0);
+        line[1] = 2 * (y_1 - y_0);
+        line[2] = x_1 * x_1 + y_1 * y_1 - x_0 * x_0 - y_0 * y_0;
+        return;
+    }
+
+    // Pixel (x, y) covers x - 0.5 to x + 0.5, so the map is -1 to 2 * size - 1
+    const long sides[4][3] = {
+        {0, 1, -1}, {1, 0, width * 2L - 1}, {0, 1, height * 2L - 1}, {1, 0, -1}
+    };
+    memcpy(line, sides[-neighbour - 1], sizeof(sides[0]));
+
+}
+
+/**
+ * Clip CELL, the NUM_VERTICES vertices of dot INDEX's cell in DOTS, to the side
+ * of its bisector with NEIGHBOUR that is closer to dot INDEX. The clipped cell
+ * is written to CLIPPED, which must have room for NUM_VERTICES + 1 vertices,
+ * and its number of vertices is returned. WIDTH and HEIGHT are the map size.
+ */
+int clip_cell(
+    const ExactVertex cell[], const int num_vertices, const Dot *dots, const int index,
+    const int neighbour, const int width, const int height, ExactVertex clipped[]
+) {
+
+    long line[3];
+    get_cell_line(dots, index, neighbour, width, height, line);
+
+    int num_clipped = 0;
+
+    for (int i = 0; i < num_vertices; i++) {
+
+        // Find Sides of the Edge's Vertices
+        // Negative is inside, 0 is on the bisector
+
+        const ExactVertex *start = &cell[i];
+        const ExactVertex *end = &cell[(i + 1) % num_vertices];
+        const __int128 start_side = line[0] * start->x + line[1] * start->y - line[2] * start->d;
+        const __int128 end_side = line[0] * end->x + line[1] * end->y - line[2] * end->d;
+
+        // Keep Inside Vertices
+
+        if (start_side <= 0) {
+            clipped[num_clipped++] = *start;
+            if (start_side == 0 && end_side > 0) {
+                // The edge leaving the bisector is replaced by the bisector
+                clipped[num_clipped - 1].neighbour = neighbour;
+            }
+        }
+
+        // Add Vertex Where the Edge Crosses the Bisector
+
+        if ((start_side < 0 && end_side > 0) || (start_side > 0 && end_side < 0)) {
+
+            long edge_line[3];
+            get_cell_line(dots, index, start->neighbour, width, height, edge_line);
+
+            __int128 d = (__int128)line[0] * edge_line[1] - (__int128)edge_line[0] * line[1];
+            __int128 x = (__int128)line[2] * edge_line[1] - (__int128)edge_line[2] * line[1];
+            __int128 y = (__int128)line[0] * edge_line[2] - (__int128)edge_line[0] * line[2];
+            if (d < 0) {
+                d = -d;
+                x = -x;
+                y = -y;
+            }
+
+            // Leaving the cell follows the bisector, entering follows the edge
+            clipped[num_clipped++] = (ExactVertex){
+                .x = x, .y = y, .d = d,
+                .neighbour = (start_side < 0) ? neighbour : start->neighbour
+            };
+
+        }
+
+    }
+
+    return num_clipped;
+
+}
+
+/**
+ * Return the largest squared distance, in half pixels, from dot INDEX in DOTS
+ * to a vertex of CELL, its cell of NUM_VERTICES vertices. A dot cuts the cell
+ * only if it is closer to dot INDEX (in pixels) than this distance.
+ */
+double get_cell_radius_sq(
+    const ExactVertex cell[], const int num_vertices, const Dot *dots, const int index
+) {
+    double radius_sq = 0;
+    for (int i = 0; i < num_vertices; i++) {
+        const double diff_x = (double)cell[i].x / (double)cell[i].d - dots[index].x * 2.0;
+        const double diff_y = (double)cell[i].y / (double)cell[i].d - dots[index].y * 2.0;
+        if (diff_x * diff_x + diff_y * diff_y > radius_sq) {
+            radius_sq = diff_x * diff_x + diff_y * diff_y;
+        }
+    }
+    return radius_sq;
+}
+
+/**
+ * Compute the cell of dot INDEX of the NUM_DOTS dots in DOTS, for a WIDTH by
+ * HEIGHT map, using TREE_ROOT, a KDTree of all of them. The cell's vertices
+ * are left in BUFFERS' cell, in order, and their number is returned. BUFFERS
+ * should start zeroed, and be freed with free_cell_buffers.
+ */
+int get_cell(
+    Node *tree_root, const int num_dots, const Dot *dots, const int index,
+    const int width, const int height, CellBuffers *buffers
+) {
+
+    if (buffers->cell == NULL) {
+        buffers->cell = malloc(4 * sizeof(ExactVertex));
+    }
+
+    // Start With the Whole Map
+
+    int num_vertices = 4;
+    const long right = width * 2L - 1;
+    const long bottom = height * 2L - 1;
+    const long corners[4][2] = {{-1, -1}, {right, -1}, {right, bottom}, {-1, bottom}};
+    for (int i = 0; i < 4; i++) {
+        // Each side is the edge leaving the corner before it
+        buffers->cell[i] = (ExactVertex){
+            .x = corners[i][0], .y = corners[i][1], .d = 1, .neighbour = -i - 1
+        };
+    }
+
+    // Clip by Nearest Neighbours
+    /*
+    Only dots closer than the cell's furthest vertex can still cut it.
+    Clipping by the same neighbour twice changes nothing, so when more
+    neighbours are needed, the cell is clipped by all of them again.
+    */
+
+    int num_neighbours = (num_dots - 1 < 16) ? num_dots - 1 : 16;
+
+    while (num_neighbours > 0) {
+
+        if (num_neighbours > buffers->max_neighbours) {
+            const int max_neighbours = num_neighbours;
+            buffers->max_neighbours = max_neighbours;
+            buffers->dists = realloc(buffers->dists, (max_neighbours + 1) * sizeof(long));
+            buffers->indexes = realloc(buffers->indexes, (max_neighbours + 1) * sizeof(int));
+            buffers->cell = realloc(buffers->cell, (max_neighbours + 5) * sizeof(ExactVertex));
+            buffers->clipped =
+                realloc(buffers->clipped, (max_neighbours + 5) * sizeof(ExactVertex));
+        }
+
+        for (int i = 0; i < num_neighbours; i++) {
+            buffers->dists[i] = LONG_MAX;
+        }
+        const int coord[2] = {dots[index].x, dots[index].y};
+        query_knn_recursive(
+            tree_root, coord, 0, buffers->dists, buffers->indexes, num_neighbours
+        );
+
+        for (int i = 0; i < num_neighbours; i++) {
+            num_vertices = clip_cell(
+                buffers->cell, num_vertices, dots, index, buffers->indexes[i], width, height,
+                buffers->clipped
+            );
+            ExactVertex *temp = buffers->cell;
+            buffers->cell = buffers->clipped;
+            buffers->clipped = temp;
+        }
+
+        // Small margin for the rounding of the radius
+        const double radius_sq =
+            get_cell_radius_sq(buffers->cell, num_vertices, dots, index) * 1.000001;
+        if (num_neighbours == num_dots - 1 || buffers->dists[num_neighbours - 1] > radius_sq) {
+            break;
+        }
+        num_neighbours *= 2;
+        if (num_neighbours > num_dots - 1) {
+            num_neighbours = num_dots - 1;
+        }
+
+    }
+
+    return num_vertices;
+
+}
+
+/**
+ * Free the lists of BUFFERS (see get_cell).
+ */
+void free_cell_buffers(CellBuffers *buffers) {
+    free(buffers->dists);
+    free(buffers->indexes);
+    free(buffers->cell);
+    free(buffers->clipped);
+}
+
+
+// Output Functions
+/*
+Streamed formats (png, qoi) are encoded by the workers one band at a time, as
+independent segments that the encoder writes in order. For png, each band is
+filtered and deflated as one segment of a zlib stream. Every segment but the
+last ends with a sync flush, so segments end on a byte boundary and can simply
+be concatenated into IDAT chunks, as pigz does. Only the zlib header and the
+combined Adler-32 are added by the encoder. For qoi, each band starts with a
+full pixel and ends any run, so it decodes correctly after any other band.
+In-place formats (ppm, raw) have a fixed size, so workers write their rows
+straight into the mapped output file, and there is nothing left to encode.
+Vector formats (svg, geojson) aren't made of pixels. Workers compute each dot's
+Voronoi cell instead, and the cells of each biome are merged into polygons as
+they're written.
+*/
+
+/**
+ * Return the Paeth predictor of A (left), B (above), and C (above left).
+ */
+int paeth_predictor(const int a, const int b, const int c) {
+    const int p = a + b - c;
+    const int pa = abs(p - a);
+    const int pb = abs(p - b);
+    const int pc = abs(p - c);
+    if (pa <= pb && pa <= pc) {
+        return a;
+    } else if (pb <= pc) {
+        return b;
+    }
+    return c;
+}
+
+/**
+ * Filter ROW, of ROW_SIZE bytes, with png filter type FILTER into OUT, and
+ * return the sum of absolute differences of the filtered bytes. PREV_ROW is the
+ * row above, which may only be NULL for the None and Sub filters. BPP is the
+ * bytes per pixel.
+ */
+long filter_row_type(
+    const unsigned char *row, const unsigned char *prev_row, const int row_size, const int bpp,
+    const int filter, unsigned char *out
+) {
+
+    // One loop per filter type, as this runs for every byte of the image
+
+    switch (filter) {
+        case 1: // Sub
+            memcpy(out, row, bpp);
+            for (int i = bpp; i < row_size; i++) {
+                out[i] = row[i] - row[i - bpp];
+            }
+            break;
+        case 2: // Up
+            for (int i = 0; i < row_size; i++) {
+                out[i] = row[i] - prev_row[i];
+            }
+            break;
+        case 3: // Average
+            for (int i = 0; i < bpp; i++) {
+                out[i] = row[i] - prev_row[i] / 2;
+            }
+            for (int i = bpp; i < row_size; i++) {
+                out[i] = row[i] - (row[i - bpp] + prev_row[i]) / 2;
+            }
+            break;
+        case 4: // Paeth
+            for (int i = 0; i < bpp; i++) {
+                out[i] = row[i] - prev_row[i]; // Paeth of (0, above, 0) is above
+            }
+            for (int i = bpp; i < row_size; i++) {
+                out[i] = row[i] - paeth_predictor(row[i - bpp], prev_row[i], prev_row[i - bpp]);
+            }
+            break;
+        default: // None
+            memcpy(out, row, row_size);
+            break;
+    }
+
+    long sum = 0;
+    for (int i = 0; i < row_size; i++) {
+        sum += abs((signed char)out[i]);
+    }
+
+    return sum;
+
+}
+
+/**
+ * Filter ROW, of ROW_SIZE bytes, into OUT, which must hold ROW_SIZE + 1 bytes.
+ * The filter type is chosen per row by the minimum sum of absolute differences,
+ * the same heuristic libpng uses. PREV_ROW is the row above, or NULL for the
+ * first row of a band, which is limited to the None and Sub filters. SCRATCH
+ * must hold ROW_SIZE bytes.
+ */
+void filter_row(
+    const unsigned char *row, const unsigned char *prev_row, const int row_size, const int bpp,
+    unsigned char *out, unsigned char *scratch
+) {
+
+    // Try Each Filter, Keeping the Best in OUT
+
+    const int num_filters = (prev_row != NULL) ? 5 : 2;
+    out[0] = 0;
+    long best_sum = filter_row_type(row, prev_row, row_size, bpp, 0, out + 1);
+
+    for (int filter = 1; filter < num_filters; filter++) {
+        const long sum = filter_row_type(row, prev_row, row_size, bpp, filter, scratch);
+        if (sum < best_sum) {
+            best_sum = sum;
+            out[0] = filter;
+            memcpy(out + 1, scratch, row_size);
+        }
+    }
+
+}
+
+/**
+ * Deflate RAW_SIZE bytes of filtered rows from FILTERED into SLOT, after a
+ * Segment header describing the result. The segment ends with a sync flush,
+ * or ends the stream when LAST is true. If deflating fails, the segment's size
+ * is SIZE_MAX.
+ */
+void deflate_band(
+    const unsigned char *filtered, const size_t raw_size, const bool last,
+    unsigned char *slot, const size_t slot_size
+) {
+
+    Segment *segment = (Segment *)slot;
+    unsigned char *data = slot + sizeof(Segment);
+
+    // Raw deflate, the zlib header and trailer are written by the encoder
+    z_stream stream = {0};
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_FILTERED) != Z_OK) {
+        segment->size = SIZE_MAX;
+        return;
+    }
+
+    stream.next_in = (unsigned char *)filtered;
+    stream.avail_in = raw_size;
+    stream.next_out = data;
+    stream.avail_out = slot_size - sizeof(Segment);
+    const int result = deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+
+    // The slot fits the worst case, so the whole band is always consumed
+    const bool deflated = (last ? result == Z_STREAM_END : result == Z_OK) &&
+        stream.avail_in == 0;
+    segment->size = deflated ? stream.total_out : SIZE_MAX;
+    segment->raw_size = raw_size;
+    segment->adler = adler32(adler32(0, NULL, 0), filtered, raw_size);
+
+    deflateEnd(&stream);
+
+}
+
+/**
+ * Write the deflated band in SLOT to PNG_PTR as one IDAT chunk. The first band
+ * also writes the zlib header, and the last band (BAND == NUM_BANDS - 1) the
+ * Adler-32 trailer. ADLER_PTR holds the Adler-32 of every band so far, and
+ * should start as adler32(0, NULL, 0).
+ */
+void write_idat_segment(
+    png_structp png_ptr, const unsigned char *slot, const int band, const int num_bands,
+    unsigned long *adler_ptr
+) {
+
+    const Segment *segment = (const Segment *)slot;
+    const unsigned char *data = slot + sizeof(Segment);
+
+    *adler_ptr = adler32_combine(*adler_ptr, segment->adler, segment->raw_size);
+
+    // Chunk Length
+
+    size_t length = segment->size;
+    if (band == 0) {
+        length += 2;
+    }
+    if (band == num_bands - 1) {
+        length += 4;
+    }
+
+    // Chunk Data
+
+    png_write_chunk_start(png_ptr, (png_const_bytep)"IDAT", length);
+    if (band == 0) {
+        // Deflate, 32K window, default compression, no dictionary
+        const unsigned char header[2] = {0x78, 0x9c};
+        png_write_chunk_data(png_ptr, header, 2);
+    }
+    png_write_chunk_data(png_ptr, data, segment->size);
+    if (band == num_bands - 1) {
+        const unsigned char trailer[4] = {
+            *adler_ptr >> 24, *adler_ptr >> 16, *adler_ptr >> 8, *adler_ptr
+        };
+        png_write_chunk_data(png_ptr, trailer, 4);
+    }
+    png_write_chunk_end(png_ptr);
+
+}
+
+/**
+ * Encode NUM_PIXELS RGB pixels from PIXELS as qoi chunks into SLOT, after a
+ * Segment header. The first pixel is always a full QOI_OP_RGB and runs end
+ * with the band, so the segment doesn't depend on the previous band's state.
+ * Pixels are never transparent, so an empty entry of the color index can't
+ * match a pixel before it has been set within the band.
+ */
+void encode_qoi_band(const unsigned char *pixels, const size_t num_pixels, unsigned char *slot) {
+
+    Segment *segment = (Segment *)slot;
+    unsigned char *data = slot + sizeof(Segment);
+    size_t pos = 0;
+
+    unsigned char index[64][3] = {{0}};
+    bool index_set[64] = {false};
+    int run = 0;
+
+    for (size_t i = 0; i < num_pixels; i++) {
+
+        const unsigned char *px = &pixels[i * 3];
+        const unsigned char *prev = (i != 0) ? &pixels[(i - 1) * 3] : NULL;
+
+        // Run of the Previous Pixel
+
+        if (prev != NULL && px[0] == prev[0] && px[1] == prev[1] && px[2] == prev[2]) {
+            run++;
+            if (run == 62) {
+                data[pos++] = 0xc0 | (run - 1); // QOI_OP_RUN
+                run = 0;
+            }
+            continue;
+        }
+        if (run > 0) {
+            data[pos++] = 0xc0 | (run - 1);
+            run = 0;
+        }
+
+        // Color Index
+
+        const int hash = (px[0] * 3 + px[1] * 5 + px[2] * 7 + 255 * 11) % 64;
+        if (
+            index_set[hash] &&
+            index[hash][0] == px[0] && index[hash][1] == px[1] && index[hash][2] == px[2]
+        ) {
+            data[pos++] = hash; // QOI_OP_INDEX
+            continue;
+        }
+        memcpy(index[hash], px, 3);
+        index_set[hash] = true;
+
+        // Difference to the Previous Pixel
+
+        if (prev != NULL) {
+            const signed char dr = px[0] - prev[0];
+            const signed char dg = px[1] - prev[1];
+            const signed char db = px[2] - prev[2];
+            const signed char dr_dg = dr - dg;
+            const signed char db_dg = db - dg;
+            if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                data[pos++] = 0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2); // QOI_OP_DIFF
+                continue;
+            }
+            if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 && db_dg >= -8 && db_dg <= 7) {
+                data[pos++] = 0x80 | (dg + 32); // QOI_OP_LUMA
+                data[pos++] = (dr_dg + 8) << 4 | (db_dg + 8);
+                continue;
+            }
+        }
+
+        // Full Pixel
+
+        data[pos++] = 0xfe; // QOI_OP_RGB
+        data[pos++] = px[0];
+        data[pos++] = px[1];
+        data[pos++] = px[2];
+
+    }
+
+    if (run > 0) {
+        data[pos++] = 0xc0 | (run - 1);
+    }
+
+    segment->size = pos;
+
+}
+
+/**
+ * Return the size of level LEVEL of a tile pyramid along a side of SIZE pixels
+ * at level 0. Each level halves the previous one, rounding up.
+ */
+int get_level_size(const int size, const int level) {
+    return (size + (1 << level) - 1) >> level;
+}
+
+/**
+ * Return the number of output pixels along a side of a view SIZE map pixels
+ * long, shown at SCALE. Views are always at least 1 pixel.
+ */
+int get_view_size(const int size, const double scale) {
+    const long view_size = lround(size * scale);
+    return (view_size < 1) ? 1 : view_size;
+}
+
+/**
+ * Downsample ROWS rows of SRC, an RGB image strip WIDTH pixels wide, by 2 in
+ * each direction into DST. Each pixel of DST is the average of a 2x2 block of
+ * SRC, where blocks on an odd right or bottom edge repeat the edge pixels.
+ */
+void downsample_rows(
+    const unsigned char *src, const int width, const int rows, unsigned char *dst
+) {
+
+    const int dst_width = get_level_size(width, 1);
+
+    for (int y = 0; y < get_level_size(rows, 1); y++) {
+
+        const unsigned char *row_0 = &src[(size_t)y * 2 * width * 3];
+        const unsigned char *row_1 = (y * 2 + 1 < rows) ? row_0 + (size_t)width * 3 : row_0;
+        unsigned char *dst_row = &dst[(size_t)y * dst_width * 3];
+
+        for (int x = 0; x < dst_width; x++) {
+            const int x_0 = x * 2 * 3;
+            const int x_1 = (x * 2 + 1 < width) ? x_0 + 3 : x_0;
+            for (int i = 0; i < 3; i++) {
+                dst_row[x * 3 + i] =
+                    (row_0[x_0 + i] + row_0[x_1 + i] + row_1[x_0 + i] + row_1[x_1 + i] + 2) / 4;
+            }
+        }
+
+    }
+
+}
+
+/**
+ * Write tile row TILE_Y of level LEVEL of a tile pyramid in DIRECTORY, from
+ * ROWS rows of STRIP, an RGB strip WIDTH pixels wide. Tiles are written as
+ * DIRECTORY/LEVEL/X_Y.png, and tiles on the right and bottom edges are cut
+ * short to fit the image. Return whether every tile was written, with a message
+ * for the first that wasn't.
+ */
+bool write_tile_row(
+    const char directory[], const int level, const int tile_y,
+    const unsigned char *strip, const int width, const int rows
+) {
+
+    for (int tile_x = 0; tile_x * 256 < width; tile_x++) {
+
+        png_image image = {0};
+        image.version = PNG_IMAGE_VERSION;
+        image.width = (width - tile_x * 256 < 256) ? width - tile_x * 256 : 256;
+        image.height = rows;
+        image.format = PNG_FORMAT_RGB;
+
+        char path[300];
+        if (snprintf(path, 300, "%s/%d/%d_%d.png", directory, level, tile_x, tile_y) >= 300) {
+            fprintf(stderr, "Couldn't write tiles to \"%s\": path too long.\n", directory);
+            return false;
+        }
+        if (!png_image_write_to_file(&image, path, 0, &strip[tile_x * 256 * 3], width * 3, NULL)) {
+            fprintf(stderr, "Couldn't write tile \"%s\": %s.\n", path, image.message);
+            return false;
+        }
+
+    }
+
+    return true;
+
+}
+
+/**
+ * Return the output format named NAME ("png", "ppm", "qoi", "raw", "tiles",
+ * "svg", or "geojson"), or -1 for an unknown name.
+ */
+int get_output_format(const char name[]) {
+    const char names[7][8] = {"png", "ppm", "qoi", "raw", "tiles", "svg", "geojson"};
+    for (int i = 0; i < 7; i++) {
+        if (strcmp(name, names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Return whether OUTPUT is a tile pyramid.
+ */
+bool is_output_tiled(const Output *output) {
+    return output->format == FORMAT_TILES;
+}
+
+/**
+ * Return whether OUTPUT is made of polygons instead of pixels.
+ */
+bool is_output_vector(const Output *output) {
+    return output->format == FORMAT_SVG || output->format == FORMAT_GEOJSON;
+}
+
+/**
+ * Return whether OUTPUT's format is written in place by the workers.
+ */
+bool is_output_in_place(const Output *output) {
+    return output->format == FORMAT_PPM || output->format == FORMAT_RAW;
+}
+
+/**
+ * Return the slot size needed to hold one encoded band of BAND_HEIGHT rows for
+ * OUTPUT. In-place formats don't use slots.
+ */
+size_t get_output_slot_size(const Output *output, const int band_height) {
+    const size_t row_size = (size_t)output->width * output->bytes_per_pixel;
+    switch (output->format) {
+        case FORMAT_PNG:
+            return sizeof(Segment) + compressBound(band_height * (row_size + 1)) + 64;
+        case FORMAT_QOI:
+            // The largest chunk, QOI_OP_RGB, is 4 bytes for 1 pixel
+            return sizeof(Segment) + (size_t)band_height * output->width * 4;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Open OUTPUT as a WIDTH by HEIGHT image of FORMAT at OUTPUT_FILE, and write
+ * its header. An OUTPUT_FILE of "-" writes streamed formats to stdout, and a
+ * null OUTPUT_FILE writes any format but tiles to memory. PALETTE
+ * selects a palette png, using COLOR_LUT (see fill_color_lut) as the palette.
+ * For tiles, OUTPUT_FILE is the directory, which is created with a directory
+ * for each level. Exits if OUTPUT_FILE can't be written, or for tiles, if it
+ * doesn't fit in the output's directory or a directory can't be created.
+ */
+void open_output(
+    Output *output, const char output_file[], const OutputFormat format, const bool palette,
+    const int width, const int height, const unsigned char color_lut[]
+) {
+
+    output->format = format;
+    output->palette = palette && format == FORMAT_PNG;
+    output->width = width;
+    output->height = height;
+    output->bytes_per_pixel = (output->palette || format == FORMAT_RAW) ? 1 : 3;
+    output->to_memory = output_file == NULL;
+    output->to_stdout = !output->to_memory && strcmp(output_file, "-") == 0;
+
+    if (!output->to_memory && !output->to_stdout && !is_output_tiled(output)) {
+        // A new file, so cache entries hard linked to the old one aren't overwritten
+        unlink(output_file);
+    }
+
+    // Tiles
+
+    if (is_output_tiled(output)) {
+
+        if (strlen(output_file) >= sizeof(output->directory)) {
+            fprintf(stderr, "Couldn't write output \"%s\": path too long.\n", output_file);
+            exit(1);
+        }
+        strcpy(output->directory, output_file);
+        if (mkdir(output->directory, 0755) != 0 && errno != EEXIST) {
+            fprintf(stderr, "Couldn't write output \"%s\": %s.\n", output_file, strerror(errno));
+            exit(1);
+        }
+
+        // Levels continue until the whole map fits in one tile
+        output->num_levels = 1;
+        while (
+            get_level_size(width, output->num_levels - 1) > 256 ||
+            get_level_size(height, output->num_levels - 1) > 256
+        ) {
+            output->num_levels++;
+        }
+
+        for (int level = 0; level < output->num_levels; level++) {
+            // Fits, as the directory is shorter than the buffer
+            char path[300];
+            snprintf(path, 300, "%s/%d", output->directory, level);
+            if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+                fprintf(stderr, "Couldn't write output \"%s\": %s.\n", path, strerror(errno));
+                exit(1);
+            }
+        }
+
+        output->level_pixels = NULL;
+        if (output->num_levels > 1) {
+            output->level_pixels = map_shared(
+                (size_t)get_level_size(width, 1) * get_level_size(height, 1) * 3
+            );
+        }
+
+        return;
+
+    }
+
+    // In-Place Formats
+
+    if (is_output_in_place(output)) {
+
+        char header[32];
+        if (format == FORMAT_PPM) {
+            output->header_size = snprintf(header, 32, "P6\n%d %d\n255\n", width, height);
+        } else {
+            // "BGRASTER", then width and height as 32-bit little-endian integers
+            memcpy(header, "BGRASTER", 8);
+            for (int i = 0; i < 4; i++) {
+                header[8 + i] = (unsigned int)width >> (i * 8);
+                header[12 + i] = (unsigned int)height >> (i * 8);
+            }
+            output->header_size = 16;
+        }
+
+        output->map_size = output->header_size + (size_t)width * height * output->bytes_per_pixel;
+        if (output->to_memory) {
+            output->fd = -1;
+            output->map = map_shared(output->map_size);
+        } else {
+            output->fd = open(output_file, O_RDWR | O_CREAT | O_TRUNC, 0644);
+            output->map = MAP_FAILED;
+            if (output->fd != -1 && ftruncate(output->fd, output->map_size) == 0) {
+                output->map = mmap(
+                    NULL, output->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, output->fd, 0
+                );
+            }
+            if (output->map == MAP_FAILED) {
+                fprintf(stderr, "Couldn't write output \"%s\".\n", output_file);
+                exit(1);
+            }
+        }
+        memcpy(output->map, header, output->header_size);
+
+        return;
+
+    }
+
+    // Streamed Formats
+
+    if (output->to_memory) {
+        output->fptr = open_memstream(&output->buffer, &output->buffer_size);
+    } else {
+        output->fptr = output->to_stdout ? stdout : fopen(output_file, "w");
+        if (output->fptr == NULL) {
+            fprintf(stderr, "Couldn't write output \"%s\".\n", output_file);
+            exit(1);
+        }
+    }
+
+    if (is_output_vector(output)) {
+        // Written all at once by write_vector_output
+        return;
+    }
+
+    if (format == FORMAT_QOI) {
+        // "qoif", width, height, 3 channels, sRGB
+        const unsigned char header[14] = {
+            'q', 'o', 'i', 'f',
+            width >> 24, width >> 16, width >> 8, width,
+            height >> 24, height >> 16, height >> 8, height,
+            3, 0
+        };
+        fwrite(header, 1, 14, output->fptr);
+        return;
+    }
+
+    output->png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    output->info_ptr = png_create_info_struct(output->png_ptr);
+    output->adler = adler32(0, NULL, 0);
+
+    png_set_IHDR(
+        output->png_ptr, output->info_ptr, width, height,
+        8, output->palette ? PNG_COLOR_TYPE_PALETTE : PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE,
+        PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT
+    );
+
+    if (output->palette) {
+        // Every pixel color is one of the 240 entries in the color lookup table
+        png_color palette_colors[240];
+        for (int i = 0; i < 240; i++) {
+            palette_colors[i].red = color_lut[i * 3];
+            palette_colors[i].green = color_lut[i * 3 + 1];
+            palette_colors[i].blue = color_lut[i * 3 + 2];
+        }
+        png_set_PLTE(output->png_ptr, output->info_ptr, palette_colors, 240);
+    }
+
+    png_init_io(output->png_ptr, output->fptr);
+    png_write_info(output->png_ptr, output->info_ptr);
+
+}
+
+/**
+ * Return row Y of an in-place OUTPUT, for a worker to write into.
+ */
+unsigned char *get_output_row(const Output *output, const int y) {
+    return &output->map[output->header_size + (size_t)y * output->width * output->bytes_per_pixel];
+}
+
+/**
+ * Write the encoded band in SLOT to a streamed OUTPUT. Bands must be written in
+ * order, and NUM_BANDS is the total number of bands. Returns false, without
+ * writing anything, if the band couldn't be encoded.
+ */
+bool write_output_band(
+    Output *output, const unsigned char *slot, const int band, const int num_bands
+) {
+    const Segment *segment = (const Segment *)slot;
+    if (segment->size == SIZE_MAX) {
+        return false;
+    }
+    if (output->format == FORMAT_PNG) {
+        write_idat_segment(output->png_ptr, slot, band, num_bands, &output->adler);
+    } else {
+        fwrite(slot + sizeof(Segment), 1, segment->size, output->fptr);
+    }
+    return true;
+}
+
+/**
+ * Return whether the edge from VERTEX, in the cell of a dot of type TYPE_INDEX,
+ * is on the boundary of its biome's region: along a map side, or shared with a
+ * dot of another type. DOT_TYPE_INDEXES holds the type index of every dot.
+ */
+bool is_region_edge(
+    const CellVertex *vertex, const int type_index, const unsigned char dot_type_indexes[]
+) {
+    return vertex->neighbour < 0 || dot_type_indexes[vertex->neighbour] != type_index;
+}
+
+/**
+ * Trace the ring of region edges (see is_region_edge) through EDGE, the index
+ * in CELL_VERTICES of a region edge of cell CELL, marking each edge in VISITED.
+ * CELL_STARTS holds the index of every cell's first vertex. The ring's points
+ * are written to POINTS as x, y pairs, and their number is returned. Points
+ * between edges along the same map side are left out.
+ */
+long trace_region_ring(
+    const long *cell_starts, const CellVertex *cell_vertices,
+    const unsigned char dot_type_indexes[], unsigned char visited[],
+    int cell, long edge, double points[]
+) {
+
+    const int type_index = dot_type_indexes[cell];
+    const long start_edge = edge;
+    int prev_neighbour = 0;
+    long num_points = 0;
+
+    do {
+
+        // Add Edge Start
+
+        const CellVertex *vertex = &cell_vertices[edge];
+        visited[edge] = 1;
+        if (vertex->neighbour >= 0 || vertex->neighbour != prev_neighbour) {
+            points[num_points * 2] = vertex->x;
+            points[num_points * 2 + 1] = vertex->y;
+            num_points++;
+        }
+        prev_neighbour = vertex->neighbour;
+
+        // Find Next Region Edge
+        /*
+        Turn around the edge's end vertex, through the cells of the region that
+        meet there, until a region edge leaves it. An edge shared with a
+        neighbour of the same type continues in the neighbour's cell, after its
+        copy of the edge, which runs the other way.
+        */
+
+        long next = (edge + 1 < cell_starts[cell + 1]) ? edge + 1 : cell_starts[cell];
+        while (!is_region_edge(&cell_vertices[next], type_index, dot_type_indexes)) {
+            const int neighbour = cell_vertices[next].neighbour;
+            long shared = cell_starts[neighbour];
+            while (cell_vertices[shared].neighbour != cell) {
+                shared++;
+            }
+            cell = neighbour;
+            next = (shared + 1 < cell_starts[cell + 1]) ? shared + 1 : cell_starts[cell];
+        }
+        edge = next;
+
+    } while (edge != start_edge);
+
+    return num_points;
+
+}
+
+/**
+ * Write the ring of NUM_POINTS x, y pairs in POINTS to FPTR as a GeoJSON linear
+ * ring, ending with its first point. The ring is written backwards if REVERSE,
+ * and y is flipped within a map HEIGHT pixels high, so north is up.
+ */
+void write_geojson_ring(
+    FILE *fptr, const double points[], const long num_points, const bool reverse,
+    const int height
+) {
+    fprintf(fptr, "[");
+    for (long i = 0; i <= num_points; i++) {
+        const long point = reverse ? (num_points - i) % num_points : i % num_points;
+        fprintf(
+            fptr, (i == 0) ? "[%.2f,%.2f]" : ",[%.2f,%.2f]",
+            points[point * 2], height - points[point * 2 + 1]
+        );
+    }
+    fprintf(fptr, "]");
+}
+
+/**
+ * Write the biome polygons of a vector OUTPUT, from the Voronoi cells of the
+ * NUM_DOTS dots in DOTS. CELL_STARTS holds the index in CELL_VERTICES of every
+ * cell's first vertex, with the total number of vertices at the end. Cells of
+ * the same type sharing an edge are merged into one region, written as a
+ * polygon with holes, and each type is filled with its base color from
+ * COLOR_LUT (see fill_color_lut). Adds to SECTION_PROGRESS[6] for each cell.
+ */
+void write_vector_output(
+    Output *output, const long *cell_starts, const CellVertex *cell_vertices,
+    const int num_dots, const Dot *dots, const unsigned char color_lut[],
+    _Atomic int *section_progress
+) {
+
+    FILE *fptr = output->fptr;
+    const bool svg = output->format == FORMAT_SVG;
+    const char type_names[12][14] = {
+        "Ice", "Shallow Water", "Water", "Deep Water",
+        "Rock", "Desert", "Jungle", "Forest", "Plains", "Taiga", "Snow", "Unknown"
+    };
+
+    unsigned char *dot_type_indexes = malloc(num_dots);
+    for (int i = 0; i < num_dots; i++) {
+        dot_type_indexes[i] = get_type_index(dots[i].type);
+    }
+
+    // Merge Cells Into Regions
+    // Every region is a set of cells of the same type, joined by shared edges
+
+    int *parents = malloc(num_dots * sizeof(int));
+    for (int i = 0; i < num_dots; i++) {
+        parents[i] = i;
+    }
+    for (int i = 0; i < num_dots; i++) {
+        for (long ii = cell_starts[i]; ii < cell_starts[i + 1]; ii++) {
+            const int neighbour = cell_vertices[ii].neighbour;
+            if (neighbour > i && dot_type_indexes[neighbour] == dot_type_indexes[i]) {
+                parents[find_root(parents, neighbour)] = find_root(parents, i);
+            }
+        }
+    }
+
+    // Region members as linked lists, in index order
+    int *region_heads = malloc(num_dots * sizeof(int));
+    int *region_next = malloc(num_dots * sizeof(int));
+    for (int i = 0; i < num_dots; i++) {
+        region_heads[i] = -1;
+    }
+    for (int i = num_dots - 1; i >= 0; i--) {
+        const int root = find_root(parents, i);
+        region_next[i] = region_heads[root];
+        region_heads[root] = i;
+    }
+
+    unsigned char *visited = calloc(cell_starts[num_dots], 1);
+    long capacity = 0;
+    double *points = NULL;
+    long *ring_starts = NULL;
+
+    // Write Header
+
+    if (svg) {
+        fprintf(
+            fptr,
+            "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"%d\" height=\"%d\" "
+            "viewBox=\"0 0 %d %d\">\n",
+            output->width, output->height, output->width, output->height
+        );
+    } else {
+        fprintf(fptr, "{\"type\":\"FeatureCollection\",\"features\":[");
+    }
+
+    // Write Each Type's Regions
+
+    bool first_type = true;
+
+    for (int type_index = 0; type_index < 12; type_index++) {
+
+        const unsigned char *color = &color_lut[(type_index * 20 + 10) * 3]; // No variation
+        bool first_region = true;
+
+        for (int root = 0; root < num_dots; root++) {
+
+            if (dot_type_indexes[root] != type_index || region_heads[root] == -1) {
+                continue;
+            }
+
+            // Start Type
+
+            if (first_region) {
+                if (svg) {
+                    fprintf(
+                        fptr, "<path fill=\"#%02x%02x%02x\" d=\"", color[0], color[1], color[2]
+                    );
+                } else {
+                    fprintf(
+                        fptr,
+                        "%s\n{\"type\":\"Feature\",\"properties\":{\"biome\":\"%s\","
+                        "\"color\":\"#%02x%02x%02x\"},\"geometry\":{\"type\":\"MultiPolygon\","
+                        "\"coordinates\":[",
+                        first_type ? "" : ",", type_names[type_index],
+                        color[0], color[1], color[2]
+                    );
+                }
+            }
+
+            // Make Room for the Region's Rings
+            // A region can't have more ring points than its cells have edges
+
+            long num_edges = 0;
+            for (int i = region_heads[root]; i != -1; i = region_next[i]) {
+                num_edges += cell_starts[i + 1] - cell_starts[i];
+            }
+            if (num_edges + 1 > capacity) {
+                capacity = num_edges + 1;
+                points = realloc(points, capacity * 2 * sizeof(double));
+                ring_starts = realloc(ring_starts, capacity * sizeof(long));
+            }
+
+            // Trace Rings
+
+            int num_rings = 0;
+            ring_starts[0] = 0;
+            for (int i = region_heads[root]; i != -1; i = region_next[i]) {
+                for (long ii = cell_starts[i]; ii < cell_starts[i + 1]; ii++) {
+                    if (
+                        !visited[ii] &&
+                        is_region_edge(&cell_vertices[ii], type_index, dot_type_indexes)
+                    ) {
+                        const long start = ring_starts[num_rings];
+                        ring_starts[++num_rings] = start + trace_region_ring(
+                            cell_starts, cell_vertices, dot_type_indexes, visited,
+                            i, ii, &points[start * 2]
+                        );
+                    }
+                }
+                atomic_fetch_add(&section_progress[6], 1);
+            }
+
+            // Write Rings
+
+            if (svg) {
+
+                // Holes wind the opposite way to outlines, so the default fill rule works
+                for (int i = 0; i < num_rings; i++) {
+                    for (long ii = ring_starts[i]; ii < ring_starts[i + 1]; ii++) {
+                        fprintf(
+                            fptr, (ii == ring_starts[i]) ? "M%.2f %.2f" : " %.2f %.2f",
+                            points[ii * 2], points[ii * 2 + 1]
+                        );
+                    }
+                    fprintf(fptr, "Z");
+                }
+
+            } else {
+
+                // Find Outline
+                /*
+                The outline is the ring with the largest area, and holes wind
+                the other way. y is flipped so north is up, and outlines must
+                be counterclockwise.
+                */
+
+                double areas[num_rings];
+                int outline = 0;
+                for (int i = 0; i < num_rings; i++) {
+                    areas[i] = 0;
+                    for (long ii = ring_starts[i]; ii < ring_starts[i + 1]; ii++) {
+                        const long next = (ii + 1 < ring_starts[i + 1]) ? ii + 1 : ring_starts[i];
+                        areas[i] += points[ii * 2] * (output->height - points[next * 2 + 1]) -
+                            points[next * 2] * (output->height - points[ii * 2 + 1]);
+                    }
+                    if (fabs(areas[i]) > fabs(areas[outline])) {
+                        outline = i;
+                    }
+                }
+                const bool reverse = areas[outline] < 0;
+
+                // Write Polygon, Outline First
+
+                fprintf(fptr, "%s[", first_region ? "" : ",");
+                write_geojson_ring(
+                    fptr, &points[ring_starts[outline] * 2],
+                    ring_starts[outline + 1] - ring_starts[outline], reverse, output->height
+                );
+                for (int i = 0; i < num_rings; i++) {
+                    if ((areas[i] < 0) != (areas[outline] < 0)) {
+                        fprintf(fptr, ",");
+                        write_geojson_ring(
+                            fptr, &points[ring_starts[i] * 2], ring_starts[i + 1] - ring_starts[i],
+                            reverse, output->height
+                        );
+                    }
+                }
+                fprintf(fptr, "]");
+
+                // Any other outline, where the region only touches itself at a point
+                for (int i = 0; i < num_rings; i++) {
+                    if (i != outline && (areas[i] < 0) == (areas[outline] < 0)) {
+                        fprintf(fptr, ",[");
+                        write_geojson_ring(
+                            fptr, &points[ring_starts[i] * 2], ring_starts[i + 1] - ring_starts[i],
+                            reverse, output->height
+                        );
+                        fprintf(fptr, "]");
+                    }
+                }
+
+            }
+
+            first_region = false;
+
+        }
+
+        // End Type
+
+        if (!first_region) {
+            fprintf(fptr, svg ? "\"/>\n" : "]}}");
+            first_type = false;
+        }
+
+    }
+
+    fprintf(fptr, svg ? "</svg>\n" : "\n]}\n");
+
+    free(points);
+    free(ring_starts);
+    free(visited);
+    free(region_heads);
+    free(region_next);
+    free(parents);
+    free(dot_type_indexes);
+
+}
+
+/**
+ * Finish writing OUTPUT, and close its file. Outputs in memory are kept, for
+ * the caller to free.
+ */
+void close_output(Output *output) {
+
+    if (is_output_tiled(output)) {
+        if (output->level_pixels != NULL) {
+            unmap_shared(
+                output->level_pixels,
+                (size_t)get_level_size(output->width, 1) * get_level_size(output->height, 1) * 3
+            );
+        }
+        return;
+    }
+
+    if (is_output_in_place(output)) {
+        if (!output->to_memory) {
+            munmap(output->map, output->map_size);
+            close(output->fd);
+        }
+        return;
+    }
+
+    if (output->format == FORMAT_PNG) {
+        png_write_chunk(output->png_ptr, (png_const_bytep)"IEND", NULL, 0);
+        png_destroy_write_struct(&output->png_ptr, &output->info_ptr);
+    } else if (output->format == FORMAT_QOI) {
+        const unsigned char end_marker[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+        fwrite(end_marker, 1, 8, output->fptr);
+    }
+
+    if (output->to_stdout) {
+        fflush(output->fptr);
+    } else {
+        fclose(output->fptr);
+    }
+
+}
+
+
+// Checkpoint Functions
+/*
+A checkpoint is the dots after a phase, so later phases can be run (or rerun)
+without the phases before them. The file is a 64 byte CheckpointHeader,
+followed by the dots array exactly as it is in memory, so it can be read with
+a single read or mapped straight into memory. Integers are in the machine's
+byte order.
+*/
+
+/**
+ * Return the phase named NAME ("sections", "assignment", "smoothing", or
+ * "biomes"), numbered like the sections of the progress tracker, or -1 for an
+ * unknown name.
+ */
+int get_phase(const char name[]) {
+    const char names[4][11] = {"sections", "assignment", "smoothing", "biomes"};
+    for (int i = 0; i < 4; i++) {
+        if (strcmp(name, names[i]) == 0) {
+            return i + 1;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Write HEADER, with its phase set to PHASE, and the dots in DOTS to a
+ * checkpoint at PATH. Nothing is written if PATH is empty, and errors are
+ * printed to stderr without stopping the program.
+ */
+void write_checkpoint(
+    const char path[], CheckpointHeader *header, const int phase, const Dot *dots
+) {
+
+    if (path[0] == '\0') {
+        return;
+    }
+
+    header->phase = phase;
+
+    FILE *fptr = fopen(path, "w");
+    bool written = fptr != NULL &&
+        fwrite(header, sizeof(CheckpointHeader), 1, fptr) == 1 &&
+        fwrite(dots, sizeof(Dot), header->num_dots, fptr) == (size_t)header->num_dots;
+    if (fptr != NULL && fclose(fptr) != 0) {
+        written = false;
+    }
+
+    if (!written) {
+        fprintf(stderr, "Couldn't write checkpoint \"%s\".\n", path);
+    }
+
+}
+
+/**
+ * Read the header of the checkpoint at PATH into HEADER. Return whether it is
+ * a checkpoint that can be read by this program.
+ */
+bool read_checkpoint_header(const char path[], CheckpointHeader *header) {
+
+    FILE *fptr = fopen(path, "r");
+    if (fptr == NULL) {
+        return false;
+    }
+
+    const bool read = fread(header, sizeof(CheckpointHeader), 1, fptr) == 1;
+    fclose(fptr);
+
+    return read && memcmp(header->magic, "BGDOTS", 6) == 0 &&
+        header->version == 1 && header->dot_size == sizeof(Dot);
+
+}
+
+/**
+ * Read the dots of the checkpoint at PATH into DOTS, which must have room for
+ * the number of dots in its header. Return whether they were read.
+ */
+bool read_checkpoint_dots(const char path[], Dot *dots) {
+
+    CheckpointHeader header;
+    FILE *fptr = fopen(path, "r");
+    if (fptr == NULL) {
+        return false;
+    }
+
+    const bool read =
+        fread(&header, sizeof(CheckpointHeader), 1, fptr) == 1 &&
+        fread(dots, sizeof(Dot), header.num_dots, fptr) == (size_t)header.num_dots;
+    fclose(fptr);
+
+    return read;
+
+}
+
+
+// Multiprocessing Functions
+// (Order of use)
+
+/**
+ * Set the process's title to "biogen-" + TYPE. If NUM >= 0, then NUM, padded to
+ * a length of 2 (not including null character) with leading zeros will be added
+ * as well. The length of TYPE + NUM (as a string) must be at max 9 characters
+ * (including null character).
+ */
+void set_process_title(const char type[], const int num) {
+
+    // Example: type is "worker", num is 6: "biogen-worker6"
+
+    // Concatenate Type
+
+    char string[16] = "biogen-";
+    strncat(string, type, 9);
+
+    // Concatenate Num
+
+    if (0 <= num && num < 100) {
+        char num_str[3];
+        snprintf(num_str, 3, "%02d", num);
+        strncat(string, num_str, 3);
+    }
+
+    // Set Process Title
+
+    #ifdef __linux__
+        prctl(PR_SET_NAME, string, 0, 0, 0);
+    #elif BSD || __Apple__
+        setproctitle(string);
+    #endif
+
+}
+
+/**
+ * Sleep for NANOSECONDS (less than 1 second). Used while waiting on other
+ * processes through shared memory.
+ */
+void sleep_ns(const long nanoseconds) {
+    struct timespec sleep_time;
+    sleep_time.tv_sec = 0;
+    sleep_time.tv_nsec = nanoseconds;
+    nanosleep(&sleep_time, &sleep_time);
+}
+
+/**
+ * Create a BandRing in shared memory for an image of HEIGHT rows, split into
+ * bands of BAND_HEIGHT rows. Workers write each band into one of NUM_SLOTS
+ * slots of SLOT_SIZE bytes, which the encoder consumes in order, so only
+ * NUM_SLOTS bands are ever held in memory.
+ */
+BandRing *create_band_ring(
+    const size_t slot_size, const int height, const int band_height, const int num_slots
+) {
+
+    const size_t slots_size = num_slots * slot_size;
+    const size_t size = sizeof(BandRing) + sizeof(int) * num_slots + slots_size;
+
+    BandRing *ring = mmap(
+        NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0
+    );
+
+    ring->num_bands = (height + band_height - 1) / band_height;
+    ring->band_height = band_height;
+    ring->slot_size = slot_size;
+    ring->num_slots = num_slots;
+    atomic_init(&ring->next_band, 0);
+    atomic_init(&ring->bands_written, 0);
+    ring->slot_bands = (_Atomic int *)(ring + 1);
+    for (int i = 0; i < num_slots; i++) {
+        atomic_init(&ring->slot_bands[i], 0);
+    }
+    ring->slots = (unsigned char *)(ring->slot_bands + num_slots);
+
+    return ring;
+
+}
+
+/**
+ * Unmap a BandRing created by create_band_ring.
+ */
+void free_band_ring(BandRing *ring) {
+    const size_t slots_size = ring->num_slots * ring->slot_size;
+    munmap(ring, sizeof(BandRing) + sizeof(int) * ring->num_slots + slots_size);
+}
+
+/**
+ * Claim the next unrendered band of RING, and wait until its slot is free.
+ * Returns the band number, or -1 once every band has been claimed. The band's
+ * rows start at get_band_slot(RING, band).
+ */
+int claim_band(BandRing *ring) {
+
+    const int band = atomic_fetch_add(&ring->next_band, 1);
+    if (band >= ring->num_bands) {
+        return -1;
+    }
+
+    // Wait for the encoder to consume the band previously in this slot
+    while (atomic_load(&ring->bands_written) <= band - ring->num_slots) {
+        sleep_ns(20000);
+    }
+
+    return band;
+
+}
+
+/**
+ * Return the first byte of the slot holding BAND in RING.
+ */
+unsigned char *get_band_slot(BandRing *ring, const int band) {
+    return &ring->slots[(band % ring->num_slots) * ring->slot_size];
+}
+
+/**
+ * Mark BAND of RING as ready to be consumed by the encoder.
+ */
+void finish_band(BandRing *ring, const int band) {
+    atomic_store(&ring->slot_bands[band % ring->num_slots], band + 1);
+}
+
+/**
+ * Wait until BAND of RING has been rendered, and return its slot. Used by the
+ * encoder, which must call release_band before waiting on the next band.
+ */
+unsigned char *wait_band(BandRing *ring, const int band) {
+    while (atomic_load(&ring->slot_bands[band % ring->num_slots]) != band + 1) {
+        sleep_ns(20000);
+    }
+    return get_band_slot(ring, band);
+}
+
+/**
+ * Free BAND's slot in RING for the workers, once the encoder is done with it.
+ */
+void release_band(BandRing *ring, const int band) {
+    atomic_store(&ring->bands_written, band + 1);
+}
+
+/**
+ * Wait for the NUM_WORKERS workers in PIDS to exit, and exit with them if any
+ * failed. Workers print their own message before failing.
+ */
+void wait_workers(const int pids[], const int num_workers) {
+    bool failed = false;
+    for (int i = 0; i < num_workers; i++) {
+        int status;
+        waitpid(pids[i], &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            failed = true;
+        }
+    }
+    if (failed) {
+        exit(1);
+    }
+}
+
+/**
+ * Place the dots of the bands of BAND_HEIGHT rows from START_BAND to END_BAND
+ * of a WIDTH by HEIGHT map, as "Water" dots in DOTS. Each band gets its share
+ * of the NUM_DOTS dots in proportion to its area, at the indexes its rows'
+ * share would start and end at. Coordinates are drawn with Floyd's algorithm,
+ * which picks the band's dots with exactly one draw each and no repeats. Draws
+ * are numbered by band and by draw (see get_random), with the map seed SEED.
+ */
+void place_dots(
+    const int band_height, const int start_band, const int end_band,
+    const int width, const int height, const unsigned int seed,
+    const int num_dots, Dot *dots, _Atomic int *section_progress
+) {
+
+    const long num_pixels = (long)width * height;
+    unsigned char *used_coords = malloc(((size_t)width * band_height + 7) / 8);
+
+    for (int band = start_band; band < end_band; band++) {
+
+        const int band_start = band * band_height;
+        const int band_rows =
+            (height - band_start < band_height) ? height - band_start : band_height;
+        const int band_pixels = width * band_rows;
+        const int start_index = (long)band_start * width * num_dots / num_pixels;
+        const int end_index = ((long)band_start + band_rows) * width * num_dots / num_pixels;
+
+        memset(used_coords, 0, ((size_t)band_pixels + 7) / 8);
+
+        // Draw Coordinates
+        /*
+        For each j from band_pixels - (dots in band) up, a coordinate is drawn
+        from 0 to j. If it's already used, j is used instead, which can't be,
+        as every earlier draw was less than j.
+        */
+
+        int j = band_pixels - (end_index - start_index);
+        for (int i = start_index; i < end_index; i++, j++) {
+
+            int ii = get_random(seed, RANDOM_PLACEMENT, (long)band << 32 | j) % (j + 1);
+            if (used_coords[ii / 8] & (1 << (ii % 8))) {
+                ii = j;
+            }
+            used_coords[ii / 8] |= 1 << (ii % 8);
+
+            dots[i] = (Dot){ .x = ii % width, .y = band_start + ii / width, .type = 'W' };
+            // Water (default)
+
+        }
+
+        atomic_fetch_add(&section_progress[1], end_index - start_index);
+
+    }
+
+    free(used_coords);
+
+}
+
+/**
+ * Place the dots of rows START_ROW to END_ROW of a grid of NUM_ROWS rows of
+ * cells over a WIDTH by HEIGHT map, as "Water" dots in DOTS. Each row gets its
+ * share of the NUM_DOTS dots, at the indexes its share would start and end at,
+ * and splits its width into one cell per dot. Each dot is at a random pixel of
+ * its own cell, drawn by dot index (see get_random) with the map seed SEED, so
+ * no two dots share a pixel and the gaps between them are at most two cells.
+ */
+void place_dots_jittered(
+    const int start_row, const int end_row, const int num_rows,
+    const int width, const int height, const unsigned int seed,
+    const int num_dots, Dot *dots, _Atomic int *section_progress
+) {
+
+    for (int row = start_row; row < end_row; row++) {
+
+        const int row_start = (long)row * height / num_rows;
+        const int row_height = (long)(row + 1) * height / num_rows - row_start;
+        const int start_index = (long)row * num_dots / num_rows;
+        const int end_index = (long)(row + 1) * num_dots / num_rows;
+        const int num_cells = end_index - start_index; // At most width (see caller)
+
+        for (int i = start_index; i < end_index; i++) {
+
+            const int cell = i - start_index;
+            const int cell_start = (long)cell * width / num_cells;
+            const int cell_width = (long)(cell + 1) * width / num_cells - cell_start;
+
+            // The low and high halves of the number are used for x and y
+            const unsigned long random = get_random(seed, RANDOM_JITTER, i);
+            dots[i] = (Dot){
+                .x = cell_start + (random & 0xFFFFFFFF) % cell_width,
+                .y = row_start + (random >> 32) % row_height,
+                .type = 'W' // Water (default)
+            };
+
+        }
+
+        atomic_fetch_add(&section_progress[1], num_cells);
+
+    }
+
+}
+
+/**
+ * Assign sections of the map. Land and water are randomly assigned based on a
+ * dot's distance from the nearest land origin dot. SEED is the map's seed.
+ */
+void assign_sections(
+    const int map_resolution, const float island_size, const unsigned int seed,
+    const int start_index, const int end_index, const int *reg_dots,
+    Node *origin_tree_root, Dot *dots, _Atomic int *section_progress
+) {
+
+    int min_dist;
+
+    for (int i = start_index; i < end_index; i++) {
+    // Non-water dots are not included
+
+        // Calculate Maximum Distance
+
+        if (i != start_index && reg_dots[i * 3 + 1] == reg_dots[(i - 1) * 3 + 1]) {
+            int min_dist_sq = (int)sqrt(min_dist) + 1 + reg_dots[i * 3] - reg_dots[(i - 1) * 3];
+            min_dist = get_dist_sq(min_dist_sq, 0);
+        } else {
+            min_dist = INT_MAX;
+        }
+
+        // Find Distance to Nearest Origin Dot
+
+        // min and dist are squared, sqrt is not done until later
+        int min_index = 0;
+        int coord[2] = {reg_dots[i * 3], reg_dots[i * 3 + 1]};
+        query_recursive(origin_tree_root, coord, 0, &min_index, &min_dist);
+
+        // Calculate Chance
+
+        float dist = sqrt(min_dist) / sqrt(map_resolution);
+        float threshold = ((float)(min_index % 20) / 19.0f * 1.5f + 0.25f) * island_size;
+
+        unsigned int chance = (dist <= threshold) ? 9 : 1;
+
+        if (get_random(seed, RANDOM_ASSIGNMENT, reg_dots[i * 3 + 2]) % 10 < chance) {
+            dots[reg_dots[i * 3 + 2]].type = 'L'; // Land
+        }
+
+        atomic_fetch_add(&section_progress[2], 1);
+
+    }
+
+}
+
+/**
+ * Return whether the dot at X, Y, a land dot if IS_LAND, is sure to change type
+ * when smoothed (1), sure not to (-1), or has to be checked by
+ * smooth_coastlines (0). Blocks of COUNTS's cells around the dot, growing until
+ * they hold its COASTLINE_SMOOTHING nearest dots of each type, bound their
+ * squared distances. REACH receives the bounds, with the distances of the
+ * furthest of them INT_MAX if the map has too few dots.
+ */
+int get_smoothing_result(
+    const CellCounts *counts, const int x, const int y, const bool is_land,
+    const int coastline_smoothing, SmoothingReach *reach
+) {
+
+    const int *same_sums = is_land ? counts->land_sums : counts->water_sums;
+    const int *opp_sums = is_land ? counts->water_sums : counts->land_sums;
+    const int cell_size = counts->cell_size;
+    const int col = x / cell_size;
+    const int row = y / cell_size;
+
+    /*
+    Every dot outside a block is at least the distance from the dot to the
+    block's nearest edge, and every dot inside it at most the distance to its
+    furthest corner. So if a block has N dots of a type and the block inside it
+    has M, the M+1th to Nth nearest are between the two blocks' distances.
+    */
+    long same_lower = 0; // Bounds of the sums of the squared distances
+    long same_upper = 0;
+    long opp_lower = 0;
+    long opp_upper = 0;
+    int num_same = 0; // Dots counted so far, up to COASTLINE_SMOOTHING
+    int num_opp = 0;
+    long inner_lower = 1; // Lower bound of the previous block, dots can't share a pixel
+    reach->same_dist = INT_MAX;
+    reach->opp_dist = INT_MAX;
+
+    for (int radius = 0; ; radius++) {
+
+        const int left = (col - radius) * cell_size;
+        const int top = (row - radius) * cell_size;
+        const int right = (col + radius + 1) * cell_size; // Exclusive
+        const int bottom = (row + radius + 1) * cell_size;
+
+        int near = (x - left + 1 < right - x) ? x - left + 1 : right - x;
+        near = (y - top + 1 < near) ? y - top + 1 : near;
+        near = (bottom - y < near) ? bottom - y : near;
+        const int far_x = (x - left > right - 1 - x) ? x - left : right - 1 - x;
+        const int far_y = (y - top > bottom - 1 - y) ? y - top : bottom - 1 - y;
+        const long lower = (long)near * near;
+        const long upper = (long)far_x * far_x + (long)far_y * far_y;
+
+        int block_same = get_block_sum(
+            same_sums, counts->num_cols, counts->num_rows, col, row, radius
+        ) - 1; // Not including itself
+        int block_opp = get_block_sum(
+            opp_sums, counts->num_cols, counts->num_rows, col, row, radius
+        );
+        block_same = (block_same < coastline_smoothing) ? block_same : coastline_smoothing;
+        block_opp = (block_opp < coastline_smoothing) ? block_opp : coastline_smoothing;
+
+        same_lower += (block_same - num_same) * inner_lower;
+        same_upper += (block_same - num_same) * upper;
+        opp_lower += (block_opp - num_opp) * inner_lower;
+        opp_upper += (block_opp - num_opp) * upper;
+        if (block_same == coastline_smoothing && num_same < coastline_smoothing) {
+            reach->same_dist = (upper < INT_MAX) ? upper : INT_MAX;
+        }
+        if (block_opp == coastline_smoothing && num_opp < coastline_smoothing) {
+            reach->opp_dist = (upper < INT_MAX) ? upper : INT_MAX;
+        }
+        num_same = block_same;
+        num_opp = block_opp;
+        inner_lower = lower;
+
+        if (
+            (num_same == coastline_smoothing && num_opp == coastline_smoothing) ||
+            (left <= 0 && top <= 0 && right >= counts->num_cols * cell_size &&
+            bottom >= counts->num_rows * cell_size)
+        ) {
+            break;
+        }
+
+    }
+
+    // Dots not in the largest block are only bounded below
+
+    same_lower += (coastline_smoothing - num_same) * inner_lower;
+    opp_lower += (coastline_smoothing - num_opp) * inner_lower;
+    reach->margin = opp_lower - same_upper;
+
+    // A dot changes type if its dots' sum is larger than the other type's
+
+    if (num_same == coastline_smoothing && same_upper <= opp_lower) {
+        return -1;
+    }
+    if (num_opp == coastline_smoothing && same_lower > opp_upper) {
+        return 1;
+    }
+    return 0;
+
+}
+
+/**
+ * Smooth map coastlines for a more realistic, aesthetically pleasing map.
+ * Reassigns land and water dots based on the average distance of the nearest
+ * COASTLINE_SMOOTHING dots of the same and opposite types, found in one search
+ * of TREE, labelled with the types before this pass (see label_recursive).
+ * COUNTS bounds the search (see get_smoothing_result).
+ * REACHES, if not null, receives the bounds of each dot's result, for later
+ * passes (see query_reach_recursive).
+ */
+void smooth_coastlines(
+    const int coastline_smoothing, const CellCounts *counts, Node *tree,
+    const int *land_dots, const int land_start, const int land_end,
+    const int *water_dots, const int water_start, const int water_end,
+    const int num_dots, const int num_land_dots, const int num_water_dots,
+    Dot *dots, SmoothingReach reaches[], _Atomic int *section_progress
+) {
+
+    int dists_same[coastline_smoothing];
+    int dists_opp[coastline_smoothing];
+    SmoothingReach reach;
+
+    for (int i = land_start; i < land_end + water_end - water_start; i++) {
+
+        // Land dots, then water dots
+        const bool is_land = i < land_end;
+        const int *dot_info = is_land ? &land_dots[i * 3] :
+            &water_dots[(i - land_end + water_start) * 3];
+        int dot_coord[2] = {dot_info[0], dot_info[1]};
+        const char same_type = is_land ? 'L' : 'W';
+
+        // Calculate Maximum Distances
+
+        get_smoothing_result(
+            counts, dot_coord[0], dot_coord[1], is_land, coastline_smoothing, &reach
+        );
+        for (int ii = 0; ii < coastline_smoothing; ii++) {
+            dists_same[ii] = reach.same_dist;
+            dists_opp[ii] = reach.opp_dist;
+        }
+
+        // Get Nearest Distances for Each Type
+
+        long sum_same = (long)reach.same_dist * coastline_smoothing;
+        query_labelled_recursive(
+            tree, dot_coord, 0, same_type, dists_same, dists_opp, coastline_smoothing, &sum_same
+        );
+
+        // Only distances below sum_same can change the result
+        long sum_opp = 0;
+        const int max = (sum_same < reach.opp_dist) ? sum_same : reach.opp_dist;
+        for (int ii = 0; ii < coastline_smoothing; ii++) {
+            dists_opp[ii] = (dists_opp[ii] < max) ? dists_opp[ii] : max;
+            sum_opp += dists_opp[ii];
+        }
+
+        // Change Dot Type if Closer to Opposite Type
+
+        if (sum_same > sum_opp) {
+            dots[dot_info[2]].type = is_land ? 'W' : 'L';
+        }
+
+        /*
+        Distances not found below max count as max, so the sums are those of
+        the nearest dots, and max copies of it, which bound later passes the
+        same way (see query_reach_recursive).
+        */
+        if (reaches != NULL) {
+            reaches[dot_info[2]] = (SmoothingReach){
+                .margin = sum_opp - sum_same, .same_dist = dists_same[coastline_smoothing - 1],
+                .opp_dist = dists_opp[coastline_smoothing - 1]
+            };
+        }
+
+        atomic_fetch_add(&section_progress[3], 1);
+
+    }
+
+}
+
+/**
+ * Smooth map coastlines for DOTS between START_INDEX and END_INDEX by density.
+ * Each dot becomes the type with more dots around it, from FIELD sampled
+ * between the centers of the four cells nearest the dot. Dots on a tie keep
+ * their type.
+ */
+void smooth_coastlines_density(
+    const DensityField *field, const int start_index, const int end_index, Dot *dots,
+    _Atomic int *section_progress
+) {
+
+    const int num_cols = field->num_cols;
+    const int num_rows = field->num_rows;
+
+    for (int i = start_index; i < end_index; i++) {
+
+        Dot *dot = &dots[i];
+
+        // Find Surrounding Cells and Weights
+
+        const double col_pos = (dot->x + 0.5) / field->cell_size - 0.5;
+        const double row_pos = (dot->y + 0.5) / field->cell_size - 0.5;
+        int left = floor(col_pos);
+        int top = floor(row_pos);
+        const double weight_x = col_pos - left;
+        const double weight_y = row_pos - top;
+        // Cells past the edges are the edge cells
+        int right = (left + 1 < num_cols) ? left + 1 : num_cols - 1;
+        int bottom = (top + 1 < num_rows) ? top + 1 : num_rows - 1;
+        left = (left > 0) ? left : 0;
+        top = (top > 0) ? top : 0;
+
+        // Sample Field
+
+        const long *top_row = &field->values[(long)top * num_cols];
+        const long *bottom_row = &field->values[(long)bottom * num_cols];
+        const double density =
+            (top_row[left] * (1 - weight_x) + top_row[right] * weight_x) * (1 - weight_y) +
+            (bottom_row[left] * (1 - weight_x) + bottom_row[right] * weight_x) * weight_y;
+
+        // Change Dot Type if Denser Opposite Type
+
+        if (density > 0) {
+            dot->type = 'L';
+        } else if (density < 0) {
+            dot->type = 'W';
+        }
+
+        atomic_fetch_add(&section_progress[3], 1);
+
+    }
+
+}
+
+/**
+ * Transform the lines of FIELD between START_INDEX and END_INDEX, its rows if
+ * AXIS is 0 and its columns if it's 1 (see transform_line). Rows should hold 0
+ * in cells with a land dot and INT_MAX elsewhere, and be transformed before
+ * the columns.
+ */
+void transform_distances(
+    const DistanceField *field, const int axis, const int start_index, const int end_index
+) {
+
+    const int length = (axis == 0) ? field->num_cols : field->num_rows;
+    const long stride = (axis == 0) ? 1 : field->num_cols; // Between cells of a line
+    const long line_stride = (axis == 0) ? field->num_cols : 1; // Between lines
+    int *dists = malloc(length * sizeof(int));
+    int *vertices = malloc(length * sizeof(int));
+    double *bounds = malloc((length + 1) * sizeof(double));
+
+    for (int i = start_index; i < end_index; i++) {
+        int *line = &field->dists[i * line_stride];
+        transform_line(line, stride, length, dists, vertices, bounds);
+        for (int ii = 0; ii < length; ii++) {
+            line[ii * stride] = dists[ii];
+        }
+    }
+
+    free(dists);
+    free(vertices);
+    free(bounds);
+
+}
+
+/**
+ * Generate water biomes for DOTS between START_INDEX and END_INDEX. Water
+ * biomes are generated based on a dot's distance to the equator and the
+ * distance to the nearest land dot. FIELD bounds each dot's land distance,
+ * which settles its biome unless a biome's distance falls within the bounds.
+ * Only then is the land tree searched.
+ */
+void generate_biomes_water(
+    const int start_index, const int end_index, const int *water_dots, Node *land_tree_root,
+    const DistanceField *field, const int height, const int num_dots, Dot *dots,
+    _Atomic int *section_progress
+) {
+
+    // A dot's land dot is in a cell at least the cell distance away, less the dots' offsets
+    const double max_offset = (field->cell_size - 1) * sqrt(2);
+    int land_dist;
+
+    for (int i = start_index; i < end_index; i++) {
+
+        // Calculate Distance to Equator
+
+        const float equator_dist =
+            fabs((float)water_dots[i * 3 + 1] - height / 2.0) / height * 20.0;
+
+        // Calculate Maximum Land Distance
+
+        if (i != start_index && water_dots[i * 3 + 1] == water_dots[(i - 1) * 3 + 1]) {
+            int min_dist_sq =
+                (int)sqrt(land_dist) + 1 + water_dots[i * 3] - water_dots[(i - 1) * 3];
+            land_dist = get_dist_sq(min_dist_sq, 0);
+        } else {
+            land_dist = INT_MAX;
+        }
+
+        // Bound Distance to Land by Cells
+        // Squared bounds are widened by one for rounding
+
+        const int coord[2] = {water_dots[i * 3], water_dots[i * 3 + 1]};
+        const long cell_index = (long)(coord[1] / field->cell_size) * field->num_cols +
+            coord[0] / field->cell_size;
+        const double cell_dist = sqrt(field->dists[cell_index]) * field->cell_size;
+        const double min_dist = (cell_dist > max_offset) ? cell_dist - max_offset : 0;
+        const double max_dist = cell_dist + max_offset;
+        const long min_dist_sq = (long)(min_dist * min_dist) - 1;
+        const long max_dist_sq = (long)ceil(max_dist * max_dist) + 1;
+        if (max_dist_sq < land_dist) {
+            land_dist = max_dist_sq;
+        }
+
+        // Set Water Biome
+        // Searches the land tree only if the bounds don't settle it
+
+        char dot_type = get_water_biome(min_dist_sq, equator_dist);
+        if (dot_type != get_water_biome(land_dist, equator_dist)) {
+            query_recursive(land_tree_root, coord, 0, NULL, &land_dist);
+            dot_type = get_water_biome(land_dist, equator_dist);
+        }
+
+        dots[water_dots[i * 3 + 2]].type = dot_type;
+
+        atomic_fetch_add(&section_progress[4], 1);
+
+    }
+
+}
+
+/**
+ * Generate land biomes for DOTS between START_INDEX and END_INDEX. Land biomes
+ * are generated base on the nearest dot in BIOME_ORIGIN_INDEXES, the list of
+ * dots whose biomes are already before this function.
+ */
+void generate_biomes_land(
+    const int start_index, const int end_index, const int *land_dots,
+    Node *origin_tree_root, const int biome_origin_indexes[],
+    const int num_dots, Dot *dots, _Atomic int *section_progress
+) {
+
+    int min_dist;
+
+    for (int i = start_index; i < end_index; i++) {
+
+        // Calculate Maxminum Distance
+
+        if (i != start_index && land_dots[i * 3 + 1] == land_dots[(i - 1) * 3 + 1]) {
+            int min_dist_sq = (int)sqrt(min_dist) + 1 + land_dots[i * 3] - land_dots[(i - 1) * 3];
+            min_dist = get_dist_sq(min_dist_sq, 0);
+        } else {
+            min_dist = INT_MAX;
+        }
+
+        // Find Nearest Biome Origin Dot
+
+        int origin_index = 0;
+        const int coord[2] = {land_dots[i * 3], land_dots[i * 3 + 1]};
+        query_recursive(origin_tree_root, coord, 0, &origin_index, &min_dist);
+
+        // Set Dot Type
+
+        dots[land_dots[i * 3 + 2]].type = dots[origin_index].type;
+
+        atomic_fetch_add(&section_progress[4], 1);
+
+    }
+
+}
+
+/**
+ * Generate bands of the image claimed from RING until every band is claimed.
+ * Each pixel is colored after the nearest dot in DOTS, using COLOR_LUT (see
+ * fill_color_lut), as 3 RGB bytes. For palette pngs, each pixel is instead
+ * 1 byte, its entry in COLOR_LUT, and for raw output, its type index (see
+ * get_type_index). In-place formats are written straight into OUTPUT, while
+ * streamed formats are encoded into the band's slot (see Output Functions).
+ * For tiles, each band is a row of level 0 tiles, and is also downsampled into
+ * level 1.
+ * The image shows VIEW of the map. DOTS and TREE_ROOT have their coordinates
+ * multiplied by SAMPLE_SCALE, so pixels between map pixels can be sampled.
+ * If COARSE isn't null, it holds the nearest dots of a smaller image of the
+ * same view, which seed the search of the pixels they cover. If NEAREST isn't
+ * null, the nearest dot of every pixel is saved to it, to seed a larger image.
+ * Also count the number of pixels of each type for TYPE_COUNTS, to be used in
+ * statistics at the end of the main program, unless it is null. TYPE_COUNTS
+ * is this worker's own, so no counts are lost to other workers' updates.
+ * Return false if a tile couldn't be written. Tiles after it are skipped, but
+ * every band is still finished, so the render isn't left waiting.
+ */
+bool generate_image(
+    BandRing *ring, const Output *output, const View *view, const int sample_scale,
+    Node *tree_root, const int num_dots, const Dot *dots, const unsigned char color_lut[],
+    const IndexGrid *coarse, IndexGrid *nearest, long *type_counts, _Atomic int *section_progress
+) {
+
+    const int width = output->width;
+    const int height = output->height;
+    const bool in_place = is_output_in_place(output);
+    bool tiles_written = true; // Until a tile can't be written
+
+    // Dot type counts for statistics, not used in image generation
+    long local_type_counts[12] = {0};
+
+    // Type index of every dot, so pixels don't need to compare types
+    unsigned char *dot_type_indexes = malloc(num_dots);
+    for (int i = 0; i < num_dots; i++) {
+        dot_type_indexes[i] = get_type_index(dots[i].type);
+    }
+
+    // Nearest dot of each pixel in the previous row, used to seed the next row
+    int *row_indexes = malloc(width * sizeof(int));
+
+    // Map coordinate of the center of each column, in sample steps
+    // At a scale of 1, this is just the map pixel
+    int *sample_xs = malloc(width * sizeof(int));
+    for (int x = 0; x < width; x++) {
+        sample_xs[x] = lround((view->x + (x + 0.5) / view->scale - 0.5) * sample_scale);
+    }
+
+    // Column of the coarse image covering the center of each column
+    int *coarse_xs = NULL;
+    if (coarse != NULL) {
+        coarse_xs = malloc(width * sizeof(int));
+        for (int x = 0; x < width; x++) {
+            coarse_xs[x] = fmin((2L * x + 1) * coarse->width / (2L * width), coarse->width - 1);
+        }
+    }
+
+    // Pixels and filtered rows of the current band, for streamed formats
+    const int row_size = width * output->bytes_per_pixel;
+    unsigned char *pixels = NULL;
+    unsigned char *filtered = NULL;
+    unsigned char *filter_scratch = NULL;
+    if (!in_place) {
+        pixels = malloc((size_t)ring->band_height * row_size);
+    }
+    const int level_width = get_level_size(width, 1);
+    if (output->format == FORMAT_PNG) {
+        filtered = malloc((size_t)ring->band_height * (row_size + 1));
+        filter_scratch = malloc(row_size);
+    }
+
+    // Generate Bands
+
+    int band;
+    while ((band = claim_band(ring)) != -1) {
+
+        const int start_height = band * ring->band_height;
+        int end_height = start_height + ring->band_height;
+        if (end_height > height) {
+            end_height = height;
+        }
+
+        for (int y = start_height; y < end_height; y++) {
+
+            unsigned char *row = in_place ?
+                get_output_row(output, y) : &pixels[(size_t)(y - start_height) * row_size];
+            const int sample_y = lround((view->y + (y + 0.5) / view->scale - 0.5) * sample_scale);
+            const int *coarse_row = NULL;
+            if (coarse != NULL) {
+                const int coarse_y =
+                    fmin((2L * y + 1) * coarse->height / (2L * height), coarse->height - 1);
+                coarse_row = &coarse->indexes[(size_t)coarse_y * coarse->width];
+            }
+            int nearest_index = 0;
+
+            for (int x = 0; x < width; x++) {
+
+                // Collect Seeds
+                /*
+                The nearest dots to the pixels to the left and above are almost
+                always the nearest dot to this pixel, or next to it. Their exact
+                distances bound the search, including at row starts. At band
+                starts, the coarse image's answer for this area does the same.
+                */
+
+                int seeds[3];
+                int num_seeds = 0;
+                if (x != 0) {
+                    seeds[num_seeds++] = nearest_index;
+                }
+                if (y != start_height) {
+                    seeds[num_seeds++] = row_indexes[x];
+                }
+                if (coarse_row != NULL) {
+                    seeds[num_seeds++] = coarse_row[coarse_xs[x]];
+                }
+
+                // Find Nearest Dot
+
+                const int coord[2] = {sample_xs[x], sample_y};
+                int min_dist = INT_MAX;
+                nearest_index = INT_MAX;
+                query_seeded(
+                    tree_root, coord, dots, seeds, num_seeds, &nearest_index, &min_dist
+                );
+                row_indexes[x] = nearest_index;
+                if (nearest != NULL) {
+                    nearest->indexes[(size_t)y * width + x] = nearest_index;
+                }
+
+                // Color Pixel and Add to Local Type Counts
+
+                const int type_index = dot_type_indexes[nearest_index];
+                const int color_index = type_index * 20 + nearest_index % 20;
+                if (output->format == FORMAT_RAW) {
+                    row[x] = type_index;
+                } else if (output->palette) {
+                    row[x] = color_index;
+                } else {
+                    const unsigned char *color = &color_lut[color_index * 3];
+                    row[x * 3] = color[0];
+                    row[x * 3 + 1] = color[1];
+                    row[x * 3 + 2] = color[2];
+                }
+                local_type_counts[type_index]++;
+
+            }
+
+            // Filter Row
+
+            if (output->format == FORMAT_PNG) {
+                unsigned char *filtered_row =
+                    &filtered[(size_t)(y - start_height) * (row_size + 1)];
+                if (output->palette) {
+                    // Palette images compress best unfiltered
+                    filtered_row[0] = 0;
+                    memcpy(filtered_row + 1, row, row_size);
+                } else {
+                    filter_row(
+                        row, (y != start_height) ? row - row_size : NULL, row_size, 3,
+                        filtered_row, filter_scratch
+                    );
+                }
+            }
+
+            // Only update for each row of pixels
+            atomic_fetch_add(&section_progress[5], 1);
+
+        }
+
+        // Encode Band
+
+        if (output->format == FORMAT_PNG) {
+            deflate_band(
+                filtered, (size_t)(end_height - start_height) * (row_size + 1),
+                band == ring->num_bands - 1, get_band_slot(ring, band), ring->slot_size
+            );
+        } else if (output->format == FORMAT_QOI) {
+            encode_qoi_band(
+                pixels, (size_t)(end_height - start_height) * width, get_band_slot(ring, band)
+            );
+        } else if (is_output_tiled(output)) {
+            // Bands are one tile high, the next level is built from the half size band
+            tiles_written = tiles_written && write_tile_row(
+                output->directory, 0, band, pixels, width, end_height - start_height
+            );
+            if (output->num_levels > 1) {
+                unsigned char *level_strip =
+                    &output->level_pixels[(size_t)start_height / 2 * level_width * 3];
+                const int level_rows = get_level_size(end_height - start_height, 1);
+                downsample_rows(pixels, width, end_height - start_height, level_strip);
+                drop_pages(level_strip, (size_t)level_rows * level_width * 3);
+            }
+        } else if (in_place) {
+            // Written rows aren't needed again, so don't let them build up in memory
+            drop_pages(
+                get_output_row(output, start_height),
+                (size_t)(end_height - start_height) * row_size
+            );
+        }
+        finish_band(ring, band);
+
+    }
+
+    free(row_indexes);
+    free(sample_xs);
+    free(coarse_xs);
+    free(pixels);
+    free(filtered);
+    free(filter_scratch);
+    free(dot_type_indexes);
+
+    // Update Worker's Type Counts
+
+    for (int i = 0; type_counts != NULL && i < 11; i++) {
+        type_counts[i] += local_type_counts[i];
+    }
+
+    return tiles_written;
+
+}
+
+/**
+ * Compute the Voronoi cells (see Voronoi Functions) of the dots in DOTS from
+ * START_INDEX to END_INDEX, using TREE_ROOT, a KDTree of all NUM_DOTS dots,
+ * for a WIDTH by HEIGHT map. If CELL_VERTICES is null, only the number of
+ * vertices of cell i is stored, at CELL_STARTS[i + 1]. Otherwise, the vertices
+ * of cell i are written to CELL_VERTICES from index CELL_STARTS[i], and each
+ * cell's area is added to TYPE_COUNTS, this worker's pixel count of its dot's
+ * type.
+ */
+void generate_cells(
+    const int start_index, const int end_index, Node *tree_root,
+    const int num_dots, const Dot *dots, const int width, const int height,
+    long *cell_starts, CellVertex *cell_vertices, long *type_counts,
+    _Atomic int *section_progress
+) {
+
+    // Areas of each type for statistics, not used in the output
+    double local_type_areas[12] = {0};
+
+    CellBuffers buffers = {0};
+
+    for (int i = start_index; i < end_index; i++) {
+
+        const int num_vertices =
+            get_cell(tree_root, num_dots, dots, i, width, height, &buffers);
+        const ExactVertex *cell = buffers.cell;
+
+        // Store Cell
+
+        if (cell_vertices == NULL) {
+            cell_starts[i + 1] = num_vertices;
+        } else {
+            double area = 0;
+            for (int ii = 0; ii < num_vertices; ii++) {
+                // Half pixels to pixels, where the map starts at 0
+                CellVertex *vertex = &cell_vertices[cell_starts[i] + ii];
+                vertex->x = ((double)cell[ii].x / (double)cell[ii].d + 1) / 2;
+                vertex->y = ((double)cell[ii].y / (double)cell[ii].d + 1) / 2;
+                vertex->neighbour = cell[ii].neighbour;
+                if (ii != 0) {
+                    area += vertex[-1].x * vertex->y - vertex->x * vertex[-1].y;
+                }
+            }
+            const CellVertex *first = &cell_vertices[cell_starts[i]];
+            const CellVertex *last = &first[num_vertices - 1];
+            area += last->x * first->y - first->x * last->y;
+            local_type_areas[get_type_index(dots[i].type)] += area / 2;
+        }
+
+        atomic_fetch_add(&section_progress[5], 1);
+
+    }
+
+    free_cell_buffers(&buffers);
+
+    // Update Worker's Type Counts
+
+    if (cell_vertices != NULL && type_counts != NULL) {
+        for (int i = 0; i < 11; i++) {
+            type_counts[i] += (long)round(local_type_areas[i]);
+        }
+    }
+
+}
+
+/**
+ * Join the dots in DOTS from START_INDEX to END_INDEX with their neighbours of
+ * the same kind, land or water, in PARENTS (see join_shared), where their
+ * Voronoi cells share an edge. Cells are found with TREE_ROOT, a KDTree of all
+ * NUM_DOTS dots of a WIDTH by HEIGHT map. Each dot's cell area, and the length
+ * of its edges with cells of the other kind, are stored in AREAS and
+ * COASTLINES, where no other worker writes.
+ */
+void join_regions(
+    const int start_index, const int end_index, Node *tree_root,
+    const int num_dots, const Dot *dots, const int width, const int height,
+    _Atomic int parents[], double areas[], double coastlines[]
+) {
+
+    CellBuffers buffers = {0};
+
+    for (int i = start_index; i < end_index; i++) {
+
+        const int num_vertices = get_cell(tree_root, num_dots, dots, i, width, height, &buffers);
+        const bool is_land = is_land_type(dots[i].type);
+
+        double area = 0;
+        double coastline = 0;
+        for (int ii = 0; ii < num_vertices; ii++) {
+
+            // Edge to the next vertex, from half pixels to pixels, where the map starts at 0
+            const ExactVertex *start = &buffers.cell[ii];
+            const ExactVertex *end = &buffers.cell[(ii + 1) % num_vertices];
+            const double start_x = ((double)start->x / (double)start->d + 1) / 2;
+            const double start_y = ((double)start->y / (double)start->d + 1) / 2;
+            const double end_x = ((double)end->x / (double)end->d + 1) / 2;
+            const double end_y = ((double)end->y / (double)end->d + 1) / 2;
+            area += start_x * end_y - end_x * start_y;
+
+            const int neighbour = start->neighbour;
+            if (neighbour < 0) {
+                continue; // Map side
+            }
+            if (is_land_type(dots[neighbour].type) != is_land) {
+                coastline += hypot(end_x - start_x, end_y - start_y);
+            } else if (neighbour > i) {
+                // Both cells have the edge, so only one joins them
+                join_shared(parents, i, neighbour);
+            }
+
+        }
+
+        areas[i] = area / 2;
+        coastlines[i] = coastline;
+
+    }
+
+    free_cell_buffers(&buffers);
+
+}
+
+/**
+ * Write the tile rows of level LEVEL of OUTPUT's tile pyramid claimed from RING,
+ * until every tile row is claimed. SRC holds the RGB pixels of the level. Each
+ * tile row is also downsampled into DST, the pixels of the next level, unless
+ * LEVEL is the last level. Return false if a tile couldn't be written, as in
+ * generate_image.
+ */
+bool generate_tile_level(
+    BandRing *ring, const Output *output, const int level,
+    const unsigned char *src, unsigned char *dst
+) {
+
+    const int width = get_level_size(output->width, level);
+    const int height = get_level_size(output->height, level);
+
+    bool tiles_written = true;
+    int tile_y;
+    while ((tile_y = claim_band(ring)) != -1) {
+
+        const int start_height = tile_y * 256;
+        const int rows = (height - start_height < 256) ? height - start_height : 256;
+        const unsigned char *strip = &src[(size_t)start_height * width * 3];
+
+        tiles_written = tiles_written &&
+            write_tile_row(output->directory, level, tile_y, strip, width, rows);
+        if (level != output->num_levels - 1) {
+            unsigned char *dst_strip =
+                &dst[(size_t)start_height / 2 * get_level_size(width, 1) * 3];
+            downsample_rows(strip, width, rows, dst_strip);
+            drop_pages(dst_strip, (size_t)get_level_size(rows, 1) * get_level_size(width, 1) * 3);
+        }
+        drop_pages((unsigned char *)strip, (size_t)rows * width * 3);
+
+        finish_band(ring, tile_y);
+
+    }
+
+    return tiles_written;
+
+}
+
+/**
+ * Render CONTEXT's map to OUTPUT_FILE in FORMAT (as a palette png if PALETTE),
+ * or if OUTPUT_FILE is null, to IMAGE in memory (see free_image). The output
+ * shows VIEW, a rectangle of the map, at its scale. This covers the Image
+ * Generation and Finish sections, whose times are added to, so the map can be
+ * rendered more than once. Pixel counts of each type are added to TYPE_COUNTS,
+ * unless it is null. COARSE and NEAREST are as in generate_image. NEAREST's
+ * indexes are mapped here, for the caller to unmap.
+ */
+void render_map(
+    MapContext *context, const char output_file[], const OutputFormat format,
+    const bool palette, const View *view, const IndexGrid *coarse, IndexGrid *nearest,
+    long *type_counts, MapImage *image
+) {
+
+    const int processes = context->config.processes;
+    const int num_dots = context->num_dots;
+    const Dot *dots = context->dots;
+    const struct timespec start_time = context->start_time;
+    _Atomic int *section_progress = context->section_progress;
+    int *section_progress_total = context->section_progress_total;
+    float *section_times = context->section_times;
+
+    int fork_pids[processes];
+
+    // Create Color Lookup Table
+
+    unsigned char color_lut[12 * 20 * 3];
+    fill_color_lut(color_lut);
+
+    // Create Output
+    // An output file of "-" writes streamed formats to stdout
+
+    Output output;
+    open_output(
+        &output, output_file, format, palette, get_view_size(view->width, view->scale),
+        get_view_size(view->height, view->scale), color_lut
+    );
+    const int width = output.width;
+    const int height = output.height;
+
+    atomic_store(&section_progress_total[5], height);
+
+    if (nearest != NULL) {
+        nearest->width = width;
+        nearest->height = height;
+        nearest->indexes = map_shared((size_t)width * height * sizeof(int));
+    }
+
+    // Scale Dots
+    /*
+    When zoomed in, output pixels fall between map pixels, so dots and pixels
+    are placed on a finer grid of SAMPLE_SCALE steps per map pixel.
+    */
+
+    const int sample_scale = (view->scale <= 1) ? 1 : fmin(ceil(view->scale) * 8, 64);
+    Dot *sample_dots = (Dot *)dots;
+    if (sample_scale != 1) {
+        sample_dots = malloc(num_dots * sizeof(Dot));
+        for (int i = 0; i < num_dots; i++) {
+            sample_dots[i] = (Dot){
+                .x = dots[i].x * sample_scale, .y = dots[i].y * sample_scale, .type = dots[i].type
+            };
+        }
+    }
+
+    // Create Dots KDTree
+
+    int *dot_coords = malloc(num_dots * 3 * sizeof(int));
+    for (int i = 0; i < num_dots; i++) {
+        const Dot *dot = &sample_dots[i];
+        dot_coords[i * 3] = dot->x;
+        dot_coords[i * 3 + 1] = dot->y;
+        dot_coords[i * 3 + 2] = i;
+    }
+    Node *tree_root = NULL;
+    tree_root = build_recursive(dot_coords, num_dots, 0);
+    free(dot_coords);
+
+    // Create Worker Type Counts
+    // Each worker counts into its own slot, which are added up once they're done
+
+    long *worker_type_counts = map_shared(processes * 11 * sizeof(long));
+
+    // Generate Voronoi Cells
+    /*
+    Vector formats are made from a cell per dot instead of pixels. Cells are
+    computed twice, first only counting their vertices, so every cell's
+    vertices can be packed into shared memory.
+    */
+
+    BandRing *ring = NULL;
+    long *cell_starts = NULL;
+    CellVertex *cell_vertices = NULL;
+
+    if (is_output_vector(&output)) {
+
+        section_progress_total[5] = num_dots * 2;
+        section_progress_total[6] = num_dots;
+
+        cell_starts = map_shared((num_dots + 1) * sizeof(long));
+
+        int cell_piece_length = num_dots / processes;
+        int cell_piece_starts[processes + 1];
+        for (int i = 0; i < processes; i++) {
+            cell_piece_starts[i] = i * cell_piece_length;
+        }
+        cell_piece_starts[processes] = num_dots;
+
+        for (int pass = 0; pass < 2; pass++) {
+
+            // Run Workers
+
+            fflush(NULL);
+            for (int i = 0; i < processes; i++) {
+
+                fork_pids[i] = fork();
+                if (fork_pids[i] != 0) {
+                    continue;
+                }
+
+                set_process_title("worker", i);
+                generate_cells(
+                    cell_piece_starts[i], cell_piece_starts[i + 1], tree_root, num_dots, dots,
+                    width, height, cell_starts, cell_vertices, &worker_type_counts[i * 11],
+                    section_progress
+                );
+                exit(0);
+
+            }
+            for (int i = 0; i < processes; i++) {
+                waitpid(fork_pids[i], NULL, 0);
+            }
+
+            // Turn Vertex Counts Into Starts
+
+            if (pass == 0) {
+                cell_starts[0] = 0;
+                for (int i = 0; i < num_dots; i++) {
+                    cell_starts[i + 1] += cell_starts[i];
+                }
+                cell_vertices = map_shared(cell_starts[num_dots] * sizeof(CellVertex));
+            }
+
+        }
+
+    } else {
+
+        // Create Band Ring
+        /*
+        Two slots per worker lets workers keep rendering while the encoder is
+        behind, while memory stays O(width * band height * processes). In-place
+        formats don't wait on the encoder, so every band gets an empty slot.
+        */
+
+        const int band_height = is_output_tiled(&output) ? 256 : 32; // Tiles are 256x256
+        const int num_bands = (height + band_height - 1) / band_height;
+        ring = (is_output_in_place(&output) || is_output_tiled(&output)) ?
+            create_band_ring(0, height, band_height, num_bands) :
+            create_band_ring(
+                get_output_slot_size(&output, band_height), height, band_height, processes * 2
+            );
+
+        atomic_store(&section_progress_total[6], num_bands);
+
+        // Run Workers
+
+        fflush(NULL); // Forks would otherwise repeat buffered output on exit
+        for (int i = 0; i < processes; i++) {
+
+            fork_pids[i] = fork();
+            if (fork_pids[i] != 0) {
+                continue;
+            }
+
+            set_process_title("worker", i);
+            const bool written = generate_image(
+                ring, &output, view, sample_scale, tree_root, num_dots, sample_dots, color_lut,
+                coarse, nearest, &worker_type_counts[i * 11], section_progress
+            );
+            exit(written ? 0 : 1);
+
+        }
+
+        // Write Bands as They're Ready
+        // Bands are already encoded, so they only need to be written in order
+
+        for (int band = 0; band < num_bands; band++) {
+            if (is_output_in_place(&output) || is_output_tiled(&output)) {
+                wait_band(ring, band);
+            } else if (write_output_band(&output, wait_band(ring, band), band, num_bands)) {
+                release_band(ring, band);
+            } else {
+                // Workers would otherwise wait forever for the slot to be released
+                fprintf(stderr, "Couldn't compress the image.\n");
+                for (int i = 0; i < processes; i++) {
+                    kill(fork_pids[i], SIGKILL);
+                }
+                exit(1);
+            }
+            atomic_fetch_add(&section_progress[6], 1);
+        }
+
+        wait_workers(fork_pids, processes);
+
+        free_band_ring(ring);
+
+    }
+
+    // Add Up Worker Type Counts
+
+    for (int i = 0; type_counts != NULL && i < processes * 11; i++) {
+        type_counts[i % 11] += worker_type_counts[i];
+    }
+    unmap_shared(worker_type_counts, processes * 11 * sizeof(long));
+
+    // Free Tree and Scaled Dots
+
+    free_recursive(tree_root);
+    if (sample_dots != dots) {
+        free(sample_dots);
+    }
+
+    // Set Section Completion Time
+    // Added to, as there can be more than one output
+
+    struct timespec time_now;
+    clock_gettime(CLOCK_REALTIME, &time_now);
+    section_times[5] += (float)(time_now.tv_sec - start_time.tv_sec) +
+        (time_now.tv_nsec - start_time.tv_nsec) / 1000000000.0 - sum_list_float(section_times, 7);
+
+    // --Finish--
+
+    // Build Tile Levels
+    // Each level is written and downsampled into the next by all workers
+
+    unsigned char *level_pixels = output.level_pixels;
+
+    for (int level = 1; is_output_tiled(&output) && level < output.num_levels; level++) {
+
+        const int level_height = get_level_size(height, level);
+        ring = create_band_ring(0, level_height, 256, (level_height + 255) / 256);
+
+        unsigned char *next_level_pixels = NULL;
+        const size_t next_level_size =
+            (size_t)get_level_size(width, level + 1) * get_level_size(height, level + 1) * 3;
+        if (level != output.num_levels - 1) {
+            next_level_pixels = map_shared(next_level_size);
+        }
+
+        for (int i = 0; i < processes; i++) {
+
+            fork_pids[i] = fork();
+            if (fork_pids[i] != 0) {
+                continue;
+            }
+
+            set_process_title("worker", i);
+            const bool written =
+                generate_tile_level(ring, &output, level, level_pixels, next_level_pixels);
+            exit(written ? 0 : 1);
+
+        }
+        wait_workers(fork_pids, processes);
+
+        // Level 1 is freed with the output
+        if (level != 1) {
+            unmap_shared(
+                level_pixels,
+                (size_t)get_level_size(width, level) * get_level_size(height, level) * 3
+            );
+        }
+        level_pixels = next_level_pixels;
+        free_band_ring(ring);
+
+    }
+
+    // Write Vector Output
+
+    if (is_output_vector(&output)) {
+        write_vector_output(
+            &output, cell_starts, cell_vertices, num_dots, dots, color_lut, section_progress
+        );
+        unmap_shared(cell_vertices, cell_starts[num_dots] * sizeof(CellVertex));
+        unmap_shared(cell_starts, (num_dots + 1) * sizeof(long));
+    }
+
+    close_output(&output);
+
+    if (output.to_memory) {
+        image->shared = is_output_in_place(&output);
+        image->data = image->shared ? output.map : (unsigned char *)output.buffer;
+        image->size = image->shared ? output.map_size : output.buffer_size;
+    }
+
+    // Set Section Completion Time
+
+    clock_gettime(CLOCK_REALTIME, &time_now);
+    section_times[6] += (float)(time_now.tv_sec - start_time.tv_sec) +
+        (time_now.tv_nsec - start_time.tv_nsec) / 1000000000.0 - sum_list_float(section_times, 7);
+
+}
+
+
+// Context Functions
+// (Order of use)
+/*
+A MapContext holds what a map is generated with: its config, its dots, and its
+progress, all in memory shared with the workers (and the progress tracker). A
+context is kept across maps, so later maps reuse its memory. A map is made in
+phases (see get_phase), which can be run one at a time, e.g. to save
+checkpoints between them, or all at once by generate_map.
+*/
+
+/**
+ * Initialize CONTEXT, before its first map. Free it with free_context.
+ */
+void init_context(MapContext *context) {
+
+    *context = (MapContext){0};
+
+    context->section_progress = map_shared(sizeof(int) * 8);
+    context->section_progress_total = map_shared(sizeof(int) * 8);
+    context->section_times = map_shared(sizeof(float) * 8);
+    context->type_counts = map_shared(sizeof(long) * 11);
+
+}
+
+/**
+ * Start a map of CONFIG in CONTEXT, timed from now. Its dots are left for the
+ * phases to create, or to be read from a checkpoint. Dots of an earlier map
+ * are overwritten, and their memory is reused if the new map's dots fit in it.
+ */
+void start_map(MapContext *context, const MapConfig *config) {
+
+    clock_gettime(CLOCK_REALTIME, &context->start_time);
+
+    context->config = *config;
+    context->num_dots = (long)config->width * config->height / config->map_resolution;
+
+    // Dots
+
+    free(context->dot_order);
+    context->dot_order = NULL;
+
+    if (context->num_dots > context->dots_capacity) {
+        if (context->dots != NULL) {
+            unmap_shared(context->dots, sizeof(Dot) * context->dots_capacity);
+        }
+        context->dots = map_shared(sizeof(Dot) * context->num_dots);
+        context->dots_capacity = context->num_dots;
+    }
+
+    // Progress
+
+    for (int i = 0; i < 8; i++) {
+        atomic_init(&context->section_progress[i], 0);
+        context->section_progress_total[i] = 1;
+        context->section_times[i] = 0;
+    }
+    for (int i = 0; i < 11; i++) {
+        context->type_counts[i] = 0;
+    }
+
+    // Set Section Completion Time
+
+    struct timespec time_now;
+    clock_gettime(CLOCK_REALTIME, &time_now);
+    context->section_times[0] = (float)(time_now.tv_sec - context->start_time.tv_sec) +
+        (time_now.tv_nsec - context->start_time.tv_nsec) / 1000000000.0;
+    atomic_store(&context->section_progress[0], 1);
+
+}
+
+/**
+ * Create the dots of CONTEXT's map, placed randomly without repeats, anywhere or
+ * one to a grid cell depending on its distribution. The first dots are then
+ * made "Land Origin" and "Water Forced" dots, and the rest are left as "Water".
+ */
+void run_section_generation(MapContext *context) {
+
+    const int width = context->config.width;
+    const int height = context->config.height;
+    const int processes = context->config.processes;
+    const unsigned int seed = context->config.seed;
+    const int num_dots = context->num_dots;
+    const int num_special_dots = num_dots / context->config.island_abundance * 2;
+    Dot *dots = context->dots;
+    _Atomic int *section_progress = context->section_progress;
+    int *section_progress_total = context->section_progress_total;
+
+    int fork_pids[processes];
+
+    section_progress_total[1] = num_dots;
+
+    // Place Dots
+    /*
+    Each band of rows gets its share of dots in proportion to its area, and
+    workers place the dots of a share of the bands each (see place_dots).
+    Jittered dots are placed the same way, by rows of grid cells, where cells
+    are about as wide as they are tall. There must be enough rows of cells that
+    none has more cells than the map is wide.
+    */
+
+    const int dot_band_height = 256;
+    const int num_bands = (height + dot_band_height - 1) / dot_band_height;
+
+    int num_cell_rows = round(height / sqrt(context->config.map_resolution));
+    if (num_cell_rows < (num_dots + width - 1) / width) {
+        num_cell_rows = (num_dots + width - 1) / width;
+    }
+    if (num_cell_rows > height) {
+        num_cell_rows = height;
+    }
+
+    for (int i = 0; i < processes; i++) {
+
+        fork_pids[i] = fork();
+        if (fork_pids[i] != 0) {
+            continue;
+        }
+
+        set_process_title("worker", i);
+        if (context->config.distribution == DISTRIBUTION_JITTERED) {
+            place_dots_jittered(
+                (long)i * num_cell_rows / processes, (long)(i + 1) * num_cell_rows / processes,
+                num_cell_rows, width, height, seed, num_dots, dots, section_progress
+            );
+        } else {
+            place_dots(
+                dot_band_height, (long)i * num_bands / processes,
+                (long)(i + 1) * num_bands / processes, width, height, seed, num_dots, dots,
+                section_progress
+            );
+        }
+        exit(0);
+
+    }
+    for (int i = 0; i < processes; i++) {
+        waitpid(fork_pids[i], NULL, 0);
+    }
+
+    // Shuffle Dots
+    /*
+    Dots are in band order, but later sections rely on dot indexes being in
+    random order (special dots, biome origins, color variation), so they are
+    shuffled with a Fisher-Yates shuffle
+    */
+
+    for (int i = num_dots - 1; i > 0; i--) {
+        const int ii = get_random(seed, RANDOM_SHUFFLE, i) % (i + 1);
+        const Dot temp = dots[i];
+        dots[i] = dots[ii];
+        dots[ii] = temp;
+    }
+
+    // Set Special Dots
+
+    for (int i = 0; i < num_special_dots; i++) {
+        if (i < num_special_dots / 2) {
+            dots[i].type = 'l'; // Land Origin, origin points for islands
+        } else {
+            dots[i].type = 'w'; // Water Forced (good for making lakes)
+        }
+    }
+
+}
+
+/**
+ * Assign the regular dots of CONTEXT's map as "Land" or "Water", based on their
+ * distance from the nearest "Land Origin" dot (see assign_sections).
+ */
+void run_section_assignment(MapContext *context) {
+
+    const int map_resolution = context->config.map_resolution;
+    const float island_size = context->config.island_size;
+    const int processes = context->config.processes;
+    const unsigned int seed = context->config.seed;
+    const int num_dots = context->num_dots;
+    const int num_special_dots = num_dots / context->config.island_abundance * 2;
+    const int num_reg_dots = num_dots - num_special_dots;
+    Dot *dots = context->dots;
+    const int *dot_order = context->dot_order;
+    _Atomic int *section_progress = context->section_progress;
+    int *section_progress_total = context->section_progress_total;
+
+    int fork_pids[processes];
+
+    section_progress_total[2] = num_reg_dots;
+
+    // Create Land Origin KDTree
+
+    const int num_origin_dots = num_special_dots / 2;
+    int *land_origin_dots = malloc(num_origin_dots * 3 * sizeof(int));
+    for (int i = 0; i < num_origin_dots; i++) {
+        Dot *dot = &dots[i];
+        land_origin_dots[i * 3] = dot->x;
+        land_origin_dots[i * 3 + 1] = dot->y;
+        land_origin_dots[i * 3 + 2] = i;
+    }
+    Node *origin_tree_root = NULL;
+    origin_tree_root = build_recursive(land_origin_dots, num_origin_dots, 0);
+    free(land_origin_dots);
+
+    // Create Regular Dots
+    // In scanline order (see sort_dots), so origin searches start from the previous dot's
+
+    int *reg_dots = malloc(num_reg_dots * 3 * sizeof(int));
+    int num_added = 0;
+    for (int i = 0; i < num_dots; i++) {
+        const int index = dot_order[i];
+        if (index < num_special_dots) {
+            continue;
+        }
+        const Dot *dot = &dots[index];
+        reg_dots[num_added * 3] = dot->x;
+        reg_dots[num_added * 3 + 1] = dot->y;
+        reg_dots[num_added * 3 + 2] = index;
+        num_added++;
+    }
+
+    // Create Regular Piece Starts
+
+    int reg_piece_length = num_reg_dots / processes;
+    int reg_piece_starts[processes + 1];
+    for (int i = 0; i < processes; i++) {
+        reg_piece_starts[i] = i * reg_piece_length;
+    }
+    reg_piece_starts[processes] = num_reg_dots;
+    /*
+    used to create x pieces of size num_reg_dots / x, where x = processes
+    last piece may be larger, special dots are skipped
+    */
+
+    // Run Workers
+
+    for (int i = 0; i < processes; i++) {
+
+        fork_pids[i] = fork(); // Create fork
+        if (fork_pids[i] != 0) {
+            continue;
+        }
+
+        // e.g. biogen-worker00
+        set_process_title("worker", i);
+        assign_sections( // Run worker
+            map_resolution, island_size, seed, reg_piece_starts[i], reg_piece_starts[i + 1],
+            reg_dots, origin_tree_root, dots, section_progress
+        );
+        exit(0); // Kill worker
+
+    }
+    for (int i = 0; i < processes; i++) {
+        waitpid(fork_pids[i], NULL, 0); // Wait for workers
+    }
+
+    // Free Regular Dots and Land Origin Tree
+
+    free(reg_dots);
+    free_recursive(origin_tree_root);
+
+}
+
+/**
+ * Smooth the coastlines of CONTEXT's map (see smooth_coastlines and
+ * smooth_coastlines_density), unless its coastline smoothing is 0. Each pass
+ * after the first smooths the coastlines left by the one before.
+ */
+void run_coastline_smoothing(MapContext *context) {
+
+    const int width = context->config.width;
+    const int height = context->config.height;
+    const int map_resolution = context->config.map_resolution;
+    const int coastline_smoothing = context->config.coastline_smoothing;
+    const int passes = context->config.smoothing_passes;
+    const int processes = context->config.processes;
+    const int num_dots = context->num_dots;
+    const int num_special_dots = num_dots / context->config.island_abundance * 2;
+    const int num_reg_dots = num_dots - num_special_dots;
+    Dot *dots = context->dots;
+    const int *dot_order = context->dot_order;
+    _Atomic int *section_progress = context->section_progress;
+    int *section_progress_total = context->section_progress_total;
+
+    if (coastline_smoothing == 0) {
+        // Coastline smoothing would have no effect
+        atomic_store(&section_progress[3], 1);
+        return;
+    }
+
+    int fork_pids[processes];
+
+    section_progress_total[3] = num_reg_dots * passes;
+
+    if (context->config.smoothing_method == SMOOTHING_DENSITY) {
+
+        // Create Density Field
+        // Cells are half the dots' spacing across, so the blur's width can be set finely
+
+        DensityField field;
+        field.cell_size = ceil(sqrt(map_resolution) / 2);
+        field.num_cols = (width + field.cell_size - 1) / field.cell_size;
+        field.num_rows = (height + field.cell_size - 1) / field.cell_size;
+        const long num_cells = (long)field.num_cols * field.num_rows;
+        field.values = malloc(num_cells * sizeof(long));
+
+        /*
+        Three box blurs of radius r are close to a Gaussian blur, with a
+        variance of r(r + 1) cells squared. Its standard deviation is 0.4 times
+        the square root of COASTLINE_SMOOTHING, in dot spacings, so the area
+        blurred together grows with the number of dots smooth_coastlines
+        compares. This scale gave the closest results to smooth_coastlines.
+        */
+        const double deviation =
+            0.4 * sqrt(coastline_smoothing) * sqrt(map_resolution) / field.cell_size;
+        const int radius = round((sqrt(1 + 4 * deviation * deviation) - 1) / 2);
+        const int buffer_length = (field.num_cols > field.num_rows) ?
+            field.num_cols : field.num_rows;
+        long *buffer = malloc(buffer_length * sizeof(long));
+
+        // Create Regular Piece Starts
+
+        int reg_piece_length = num_reg_dots / processes;
+        int reg_piece_starts[processes + 1];
+        for (int i = 0; i < processes; i++) {
+            reg_piece_starts[i] = num_special_dots + i * reg_piece_length;
+        }
+        reg_piece_starts[processes] = num_dots;
+
+        for (int pass = 0; pass < passes; pass++) {
+
+            // Count Land and Water Dots in Grid Cells
+
+            memset(field.values, 0, num_cells * sizeof(long));
+            for (int i = num_special_dots; i < num_dots; i++) {
+                const Dot *dot = &dots[i];
+                const long cell_index =
+                    (long)(dot->y / field.cell_size) * field.num_cols + dot->x / field.cell_size;
+                field.values[cell_index] += (dot->type == 'L') ? 1 : -1;
+            }
+
+            // Blur Field
+
+            for (int i = 0; i < 3 && radius > 0; i++) {
+                blur_box(field.values, field.num_cols, field.num_rows, radius, buffer);
+            }
+
+            // Run Workers
+
+            for (int i = 0; i < processes; i++) {
+
+                fork_pids[i] = fork();
+                if (fork_pids[i] != 0) {
+                    continue;
+                }
+
+                set_process_title("worker", i);
+                smooth_coastlines_density(
+                    &field, reg_piece_starts[i], reg_piece_starts[i + 1], dots, section_progress
+                );
+                exit(0);
+
+            }
+            for (int i = 0; i < processes; i++) {
+                waitpid(fork_pids[i], NULL, 0);
+            }
+
+        }
+
+        free(buffer);
+        free(field.values);
+        return;
+
+    }
+
+    // Create Labelled KDTree of Regular Dots
+    /*
+    Dots of both types are in one tree, labelled with their types before each
+    pass, so each dot's nearest dots of each type are found in one search (see
+    query_labelled_recursive). Later passes only label it again.
+    */
+
+    int num_land_dots = 0;
+    int num_water_dots = 0;
+    int *land_dots = malloc(num_reg_dots * 3 * sizeof(int));
+    int *water_dots = malloc(num_reg_dots * 3 * sizeof(int));
+    // num_land_dots + num_water_dots == num_reg_dots, so this is the max
+
+    // The land list holds every regular dot until the lists are refilled
+    for (int i = num_special_dots; i < num_dots; i++) {
+        const Dot *dot = &dots[i];
+        land_dots[(i - num_special_dots) * 3] = dot->x;
+        land_dots[(i - num_special_dots) * 3 + 1] = dot->y;
+        land_dots[(i - num_special_dots) * 3 + 2] = i;
+    }
+    Node *tree = build_recursive(land_dots, num_reg_dots, 0);
+
+    // Create Grid Cell Counts
+    // Cells are a quarter of the dots' spacing across, so blocks fit distances closely
+
+    CellCounts counts;
+    counts.cell_size = ceil(sqrt(map_resolution) / 4);
+    counts.num_cols = (width + counts.cell_size - 1) / counts.cell_size;
+    counts.num_rows = (height + counts.cell_size - 1) / counts.cell_size;
+    const int cell_size = counts.cell_size;
+    const int num_cols = counts.num_cols;
+    const int num_rows = counts.num_rows;
+    const int sums_width = num_cols + 1;
+    const size_t sums_size = (size_t)sums_width * (num_rows + 1) * sizeof(int);
+    int *land_sums = malloc(sums_size);
+    int *water_sums = malloc(sums_size);
+    counts.land_sums = land_sums;
+    counts.water_sums = water_sums;
+
+    // Create Pass Lists
+    /*
+    After the first pass, only dots that the dots changed by the last pass
+    could change are checked again. Every dot's result from the last pass it
+    was checked in is kept with the bounds it came from, which dots changed
+    since then use up (see query_reach_recursive).
+    */
+
+    char *types = NULL; // Types before the pass, as dots are changed during it
+    SmoothingReach *reaches = NULL; // Shared with workers
+    CellCounts changed_counts; // Dots changed by the last pass, to land and to water
+    changed_counts.land_sums = NULL;
+    changed_counts.water_sums = NULL;
+    changed_counts.cell_size = ceil(sqrt(map_resolution));
+    changed_counts.num_cols = (width + changed_counts.cell_size - 1) / changed_counts.cell_size;
+    changed_counts.num_rows = (height + changed_counts.cell_size - 1) / changed_counts.cell_size;
+    const size_t changed_sums_size =
+        (size_t)(changed_counts.num_cols + 1) * (changed_counts.num_rows + 1) * sizeof(int);
+    if (passes > 1) {
+        types = malloc(num_dots);
+        reaches = map_shared(num_dots * sizeof(SmoothingReach));
+        changed_counts.land_sums = malloc(changed_sums_size);
+        changed_counts.water_sums = malloc(changed_sums_size);
+        for (int i = num_special_dots; i < num_dots; i++) {
+            types[i] = dots[i].type;
+        }
+    }
+    int *changed_dots = malloc(num_reg_dots * sizeof(int));
+
+    for (int pass = 0; pass < passes; pass++) {
+
+        Node *changed_trees[2] = {NULL, NULL}; // Dots changed to land, then to water
+
+        if (pass > 0) {
+
+            // Create KDTrees of Dots Changed by the Last Pass
+
+            num_land_dots = 0;
+            num_water_dots = 0;
+            for (int i = num_special_dots; i < num_dots; i++) {
+                const Dot *dot = &dots[i];
+                if (dot->type == types[i]) {
+                    continue;
+                }
+                if (dot->type == 'L') {
+                    land_dots[num_land_dots * 3] = dot->x;
+                    land_dots[num_land_dots * 3 + 1] = dot->y;
+                    land_dots[num_land_dots * 3 + 2] = i;
+                    num_land_dots++;
+                } else {
+                    water_dots[num_water_dots * 3] = dot->x;
+                    water_dots[num_water_dots * 3 + 1] = dot->y;
+                    water_dots[num_water_dots * 3 + 2] = i;
+                    num_water_dots++;
+                }
+            }
+
+            if (num_land_dots + num_water_dots == 0) {
+                // No other pass would change anything either
+                atomic_fetch_add(&section_progress[3], num_reg_dots * (passes - pass));
+                break;
+            }
+
+            memset(changed_counts.land_sums, 0, changed_sums_size);
+            memset(changed_counts.water_sums, 0, changed_sums_size);
+            const int changed_size = changed_counts.cell_size;
+            const int changed_width = changed_counts.num_cols + 1;
+            for (int i = 0; i < num_land_dots; i++) {
+                changed_counts.land_sums[(land_dots[i * 3 + 1] / changed_size + 1) *
+                    changed_width + land_dots[i * 3] / changed_size + 1]++;
+            }
+            for (int i = 0; i < num_water_dots; i++) {
+                changed_counts.water_sums[(water_dots[i * 3 + 1] / changed_size + 1) *
+                    changed_width + water_dots[i * 3] / changed_size + 1]++;
+            }
+            sum_cells(changed_counts.land_sums, changed_counts.num_cols, changed_counts.num_rows);
+            sum_cells(changed_counts.water_sums, changed_counts.num_cols, changed_counts.num_rows);
+
+            if (num_land_dots > 0) {
+                changed_trees[0] = build_recursive(land_dots, num_land_dots, 0);
+            }
+            if (num_water_dots > 0) {
+                changed_trees[1] = build_recursive(water_dots, num_water_dots, 0);
+            }
+
+        }
+
+        label_recursive(tree, dots);
+
+        // Count Land and Water Dots in Grid Cells
+
+        memset(land_sums, 0, sums_size);
+        memset(water_sums, 0, sums_size);
+        for (int i = num_special_dots; i < num_dots; i++) {
+            const Dot *dot = &dots[i];
+            const int sums_index = (dot->y / cell_size + 1) * sums_width + dot->x / cell_size + 1;
+            if (dot->type == 'L') {
+                land_sums[sums_index]++;
+            } else {
+                water_sums[sums_index]++;
+            }
+        }
+        sum_cells(land_sums, num_cols, num_rows);
+        sum_cells(water_sums, num_cols, num_rows);
+
+        // Refill Land and Water Dots to Check in Scanline Order
+        /*
+        The trees are built from dots in index order, as building from sorted
+        dots is slow (see median_sort_recursive). The trees keep their own
+        coordinates, so the lists are then refilled in scanline order for the
+        workers, with only the dots whose result the cell counts can't settle
+        (see get_smoothing_result). The rest are changed, or not, here. Trees
+        and counts are of the types before the pass, so the order doesn't
+        matter.
+        */
+
+        int num_changed_dots = 0;
+        int num_skipped_dots = 0; // Settled, or not changed by the last pass's changes
+
+        num_land_dots = 0;
+        num_water_dots = 0;
+        for (int i = 0; i < num_dots; i++) {
+            const int index = dot_order[i];
+            if (index < num_special_dots) {
+                continue;
+            }
+            const Dot *dot = &dots[index];
+            const bool is_land = dot->type == 'L';
+            if (pass > 0) {
+                const bool changed = dot->type != types[index];
+                types[index] = dot->type;
+                if (!changed) {
+                    /*
+                    Only dots changed to the other type can change this dot.
+                    If the blocks of cells around it hold none within
+                    same_dist, and few enough within opp_dist, they can use up
+                    at most opp_dist each (see query_reach_recursive).
+                    */
+                    const SmoothingReach *reach = &reaches[index];
+                    const int *away_sums =
+                        is_land ? changed_counts.water_sums : changed_counts.land_sums;
+                    const int col = dot->x / changed_counts.cell_size;
+                    const int row = dot->y / changed_counts.cell_size;
+                    const int num_near = get_block_sum(
+                        away_sums, changed_counts.num_cols, changed_counts.num_rows, col, row,
+                        ceil(sqrt(reach->same_dist) / changed_counts.cell_size)
+                    );
+                    const int num_far = get_block_sum(
+                        away_sums, changed_counts.num_cols, changed_counts.num_rows, col, row,
+                        ceil(sqrt(reach->opp_dist) / changed_counts.cell_size)
+                    );
+                    long sum = (long)num_far * reach->opp_dist;
+                    if (num_near != 0 || sum > reach->margin) {
+                        sum = 0;
+                        const int dot_coord[2] = {dot->x, dot->y};
+                        query_reach_recursive(
+                            changed_trees[is_land ? 1 : 0], dot_coord, 0, reach, &sum
+                        );
+                    }
+                    if (sum <= reaches[index].margin) {
+                        reaches[index].margin -= sum;
+                        num_skipped_dots++;
+                        continue;
+                    }
+                }
+            }
+            SmoothingReach reach;
+            const int result = get_smoothing_result(
+                &counts, dot->x, dot->y, is_land, coastline_smoothing, &reach
+            );
+            if (result != 0) {
+                if (result == 1) {
+                    changed_dots[num_changed_dots++] = index;
+                }
+                if (reaches != NULL) {
+                    reaches[index] = reach;
+                }
+                num_skipped_dots++;
+            } else if (is_land) {
+                land_dots[num_land_dots * 3] = dot->x;
+                land_dots[num_land_dots * 3 + 1] = dot->y;
+                land_dots[num_land_dots * 3 + 2] = index;
+                num_land_dots++;
+            } else {
+                water_dots[num_water_dots * 3] = dot->x;
+                water_dots[num_water_dots * 3 + 1] = dot->y;
+                water_dots[num_water_dots * 3 + 2] = index;
+                num_water_dots++;
+            }
+        }
+
+        // Types are changed after every dot has been settled, as the counts are of the old types
+        for (int i = 0; i < num_changed_dots; i++) {
+            Dot *dot = &dots[changed_dots[i]];
+            dot->type = (dot->type == 'L') ? 'W' : 'L';
+        }
+
+        atomic_fetch_add(&section_progress[3], num_skipped_dots);
+
+        // Create Piece Starts for Land and Water Dots
+
+        int land_piece_length = num_land_dots / processes;
+        int land_piece_starts[processes + 1];
+        for (int i = 0; i < processes; i++) {
+            land_piece_starts[i] = i * land_piece_length;
+        }
+        land_piece_starts[processes] = num_land_dots;
+
+        int water_piece_length = num_water_dots / processes;
+        int water_piece_starts[processes + 1];
+        for (int i = 0; i < processes; i++) {
+            water_piece_starts[i] = i * water_piece_length;
+        }
+        water_piece_starts[processes] = num_water_dots;
+
+        // Run Workers
+
+        for (int i = 0; i < processes; i++) {
+
+            fork_pids[i] = fork();
+            if (fork_pids[i] != 0) {
+                continue;
+            }
+
+            set_process_title("worker", i);
+            smooth_coastlines(
+                coastline_smoothing, &counts, tree,
+                land_dots, land_piece_starts[i], land_piece_starts[i + 1],
+                water_dots, water_piece_starts[i], water_piece_starts[i + 1],
+                num_dots, num_land_dots, num_water_dots, dots, reaches, section_progress
+            );
+            exit(0);
+
+        }
+        for (int i = 0; i < processes; i++) {
+            waitpid(fork_pids[i], NULL, 0);
+        }
+
+        for (int i = 0; i < 2; i++) {
+            if (changed_trees[i] != NULL) {
+                free_recursive(changed_trees[i]);
+            }
+        }
+
+    }
+
+    // Free Dot Lists and Trees
+
+    free(land_dots);
+    free(water_dots);
+    free(land_sums);
+    free(water_sums);
+    free(changed_dots);
+    if (passes > 1) {
+        free(types);
+        unmap_shared(reaches, num_dots * sizeof(SmoothingReach));
+        free(changed_counts.land_sums);
+        free(changed_counts.water_sums);
+    }
+
+    free_recursive(tree);
+
+}
+
+/**
+ * Give every dot of CONTEXT's map its biome. Water biomes depend on distance
+ * from land, and land biomes on the nearest biome origin dot, whose biome
+ * depends on its distance from the equator.
+ */
+void run_biome_generation(MapContext *context) {
+
+    const int width = context->config.width;
+    const int height = context->config.height;
+    const int map_resolution = context->config.map_resolution;
+    const int processes = context->config.processes;
+    const unsigned int seed = context->config.seed;
+    const int num_dots = context->num_dots;
+    const int num_special_dots = num_dots / context->config.island_abundance * 2;
+    Dot *dots = context->dots;
+    const int *dot_order = context->dot_order;
+    _Atomic int *section_progress = context->section_progress;
+    int *section_progress_total = context->section_progress_total;
+
+    int fork_pids[processes];
+
+    atomic_store(&section_progress_total[4], num_dots);
+
+    // Remove "Land Origin" and "Water Forced" Dots
+
+    for (int i = 0; i < num_special_dots; i++) {
+        Dot *dot = &dots[i];
+        if (dot->type == 'l') {
+            dot->type = 'L';
+        } else if (dot->type == 'w') {
+            dot->type = 'W';
+        }
+    }
+
+    // Create Water Biomes
+    // Adds ice, depth
+
+    // Build Land Dots KDTree
+
+    int num_land_dots = 0;
+    int num_water_dots = 0;
+    int *land_dots = malloc(num_dots * 3 * sizeof(int));
+    int *water_dots = malloc(num_dots * 3 * sizeof(int));
+
+    for (int i = 0; i < num_dots; i++) {
+        const Dot *dot = &dots[i];
+        if (dots[i].type == 'L') {
+            land_dots[num_land_dots * 3] = dot->x;
+            land_dots[num_land_dots * 3 + 1] = dot->y;
+            land_dots[num_land_dots * 3 + 2] = i;
+            num_land_dots++;
+        }
+    }
+
+    Node *land_tree_root = NULL;
+    land_tree_root = build_recursive(land_dots, num_land_dots, 0);
+    free(land_dots);
+
+    // Create Land Distance Field
+    /*
+    Squared distances from each cell to the nearest cell with a land dot bound
+    every water dot's land distance, which is only needed near the distances
+    where biomes change (see generate_biomes_water). Cells are half the dots'
+    spacing across, which left the fewest dots to search for.
+    */
+
+    DistanceField field;
+    field.cell_size = ceil(sqrt(map_resolution) / 2);
+    field.num_cols = (width + field.cell_size - 1) / field.cell_size;
+    field.num_rows = (height + field.cell_size - 1) / field.cell_size;
+    const long num_cells = (long)field.num_cols * field.num_rows;
+    field.dists = map_shared(num_cells * sizeof(int));
+
+    for (long i = 0; i < num_cells; i++) {
+        field.dists[i] = INT_MAX;
+    }
+    for (int i = 0; i < num_dots; i++) {
+        const Dot *dot = &dots[i];
+        if (dot->type == 'L') {
+            field.dists[(long)(dot->y / field.cell_size) * field.num_cols +
+                dot->x / field.cell_size] = 0;
+        }
+    }
+
+    // Transform Rows, then Columns
+
+    for (int axis = 0; axis < 2; axis++) {
+
+        const int num_lines = (axis == 0) ? field.num_rows : field.num_cols;
+        int line_piece_starts[processes + 1];
+        for (int i = 0; i < processes; i++) {
+            line_piece_starts[i] = i * (num_lines / processes);
+        }
+        line_piece_starts[processes] = num_lines;
+
+        for (int i = 0; i < processes; i++) {
+
+            fork_pids[i] = fork();
+            if (fork_pids[i] != 0) {
+                continue;
+            }
+
+            set_process_title("worker", i);
+            transform_distances(&field, axis, line_piece_starts[i], line_piece_starts[i + 1]);
+            exit(0);
+
+        }
+        for (int i = 0; i < processes; i++) {
+            waitpid(fork_pids[i], NULL, 0);
+        }
+
+    }
+
+    // Create Water Dots
+    // In scanline order (see sort_dots), so the previous dot's land distance caps the next's
+
+    for (int i = 0; i < num_dots; i++) {
+        const int index = dot_order[i];
+        const Dot *dot = &dots[index];
+        if (dot->type != 'L') {
+            water_dots[num_water_dots * 3] = dot->x;
+            water_dots[num_water_dots * 3 + 1] = dot->y;
+            water_dots[num_water_dots * 3 + 2] = index;
+            num_water_dots++;
+        }
+    }
+
+    // Create Piece Starts Water Dots
+
+    int water_piece_length = num_water_dots / processes;
+    int water_piece_starts[processes + 1];
+    for (int i = 0; i < processes; i++) {
+        water_piece_starts[i] = i * water_piece_length;
+    }
+    water_piece_starts[processes] = num_water_dots;
+
+    // Run Workers
+
+    for (int i = 0; i < processes; i++) {
+
+        fork_pids[i] = fork();
+        if (fork_pids[i] != 0) {
+            continue;
+        }
+
+        set_process_title("worker", i);
+        generate_biomes_water(
+            water_piece_starts[i], water_piece_starts[i + 1], water_dots, land_tree_root,
+            &field, height, num_dots, dots, section_progress
+        );
+        exit(0);
+
+    }
+    for (int i = 0; i < processes; i++) {
+        waitpid(fork_pids[i], NULL, 0);
+    }
+
+    // Free Water Dots, Land Tree, and Distance Field
+
+    free(water_dots);
+    free_recursive(land_tree_root);
+    unmap_shared(field.dists, num_cells * sizeof(int));
+
+    // Add Biome Origin Dots
+    // The area around a biome origin dot will have the same biome
+
+    int *biome_origin_indexes = malloc(num_dots / 10 * sizeof(int));
+    int num_biome_dots = 0;
+
+    int ii = 0;
+    while (num_biome_dots < num_dots / 10) {
+
+        // Biome origin dot must be land, small maps may run out of land dots
+        while (ii < num_dots && dots[ii].type != 'L') {
+            ii++;
+        }
+        if (ii == num_dots) {
+            break;
+        }
+        biome_origin_indexes[num_biome_dots++] = ii;
+
+        Dot *dot = &dots[ii];
+
+        const float equator_dist = fabs((float)dot->y - height / 2.0) / height * 20.0;
+
+        char probs[10];
+        if (equator_dist < 1) {
+            memcpy(
+                probs, (char[]){'R', 'D', 'D', 'D', 'J', 'J', 'J', 'F', 'F', 'P'}, sizeof(probs)
+            );
+        } else if (equator_dist < 2) {
+            memcpy(
+                probs, (char[]){'R', 'D', 'D', 'D', 'J', 'J', 'F', 'F', 'P', 'P'}, sizeof(probs)
+            );
+        } else if (equator_dist < 3) {
+            memcpy(
+                probs, (char[]){'R', 'D', 'D', 'J', 'F', 'F', 'F', 'P', 'P', 'P'}, sizeof(probs)
+            );
+        } else if (equator_dist < 4) {
+            memcpy(
+                probs, (char[]){'R', 'D', 'J', 'F', 'F', 'F', 'P', 'P', 'P', 'P'}, sizeof(probs)
+            );
+        } else if (equator_dist < 5) {
+            memcpy(
+                probs, (char[]){'R', 'D', 'F', 'F', 'F', 'F', 'P', 'P', 'P', 'P'}, sizeof(probs)
+            );
+        } else if (equator_dist < 6) {
+            memcpy(
+                probs, (char[]){'R', 'F', 'F', 'F', 'F', 'F', 'P', 'P', 'P', 'P'}, sizeof(probs)
+            );
+        } else if (equator_dist < 7) {
+            memcpy(
+                probs, (char[]){'R', 'T', 'F', 'F', 'F', 'F', 'F', 'P', 'P', 'P'}, sizeof(probs)
+            );
+        } else if (equator_dist < 8) {
+            memcpy(
+                probs, (char[]){'R', 'S', 'S', 'T', 'T', 'F', 'F', 'F', 'P', 'P'}, sizeof(probs)
+            );
+        } else if (equator_dist < 9) {
+            memcpy(
+                probs, (char[]){'S', 'S', 'S', 'S', 'T', 'T', 'T', 'T', 'T', 'F'}, sizeof(probs)
+            );
+        } else {
+            for (int ii = 0; ii < 10; ii++) {
+                probs[ii] = 'S';
+            }
+        }
+
+        /*
+        Probability Chart, 1 box = 10% Chance
+        Uppercase/lowercase are an attempt to make it easier to read, they mean nothing
+        This also means s represents snow, not shallow water
+        0-1 | r D D D J J J f f P
+        1-2 | r D D D J J f f P P
+        2-3 | r D D J f f f P P P
+        3-4 | r D J f f f P P P P
+        4-5 | r D f f f f P P P P
+        5-6 | r f f f f f P P P P
+        6-7 | r T f f f f f P P P
+        7-8 | r s s T T f f f P P
+        8-9 | s s s s T T T T f f
+        9-10| s s s s s s s s s s
+        */
+
+        dot->type = probs[get_random(seed, RANDOM_BIOMES, ii) % 10];
+
+        ii++;
+
+        atomic_fetch_add(&section_progress[4], 1);
+
+    }
+
+    // Create Land Biomes
+    // Land dots are assigned the biome of the nearest biome origin dot
+
+    // Create Biome Origin KDTree
+
+    int *biome_dots = malloc(num_biome_dots * 3 * sizeof(int));
+    for (int i = 0; i < num_biome_dots; i++) {
+        const Dot *dot = &dots[biome_origin_indexes[i]];
+        biome_dots[i * 3] = dot->x;
+        biome_dots[i * 3 + 1] = dot->y;
+        biome_dots[i * 3 + 2] = biome_origin_indexes[i];
+    }
+    Node *biome_tree_root = NULL;
+    biome_tree_root = build_recursive(biome_dots, num_biome_dots, 0);
+    free(biome_dots);
+
+    // Create Lands
+    // Original "land_dots" was freed in water biome generation
+    // In scanline order (see sort_dots), so biome origin searches start from the previous dot's
+
+    int num_land_dots2 = 0;
+    int *land_dots2 = malloc(num_dots * 3 * sizeof(int));
+    for (int i = 0; i < num_dots; i++) {
+        const int index = dot_order[i];
+        const Dot *dot = &dots[index];
+        if (dot->type == 'L') {
+            land_dots2[num_land_dots2 * 3] = dot->x;
+            land_dots2[num_land_dots2 * 3 + 1] = dot->y;
+            land_dots2[num_land_dots2 * 3 + 2] = index;
+            num_land_dots2++;
+        }
+    }
+
+    // Create Piece Starts Land Dots
+
+    int land_piece_length = num_land_dots2 / processes;
+    int land_piece_starts[processes + 1];
+    for (int i = 0; i < processes; i++) {
+        land_piece_starts[i] = i * land_piece_length;
+    }
+    land_piece_starts[processes] = num_land_dots2;
+
+    // Run Workers
+
+    for (int i = 0; i < processes; i++) {
+
+        fork_pids[i] = fork();
+        if (fork_pids[i] != 0) {
+            continue;
+        }
+
+        set_process_title("worker", i);
+        generate_biomes_land(
+            land_piece_starts[i], land_piece_starts[i + 1], land_dots2,
+            biome_tree_root, biome_origin_indexes, num_dots, dots, section_progress
+        );
+        exit(0);
+
+    }
+    for (int i = 0; i < processes; i++) {
+        waitpid(fork_pids[i], NULL, 0);
+    }
+
+    // Free Land Dots and Biome Tree
+
+    free(land_dots2);
+    free(biome_origin_indexes);
+    free_recursive(biome_tree_root);
+
+}
+
+/**
+ * Run PHASE (see get_phase) of CONTEXT's map. The phases before it must have
+ * been run, or read from a checkpoint.
+ */
+void run_phase(MapContext *context, const int phase) {
+
+    fflush(NULL); // Forks would otherwise repeat buffered output on exit
+
+    // Sort Dots
+    // Dots don't move after phase 1, so they're sorted once, for the lists of later phases
+
+    if (phase > 1 && context->dot_order == NULL) {
+        context->dot_order = malloc(context->num_dots * sizeof(int));
+        sort_dots(
+            context->dots, context->num_dots, context->config.width, context->config.height,
+            context->dot_order
+        );
+    }
+
+    if (phase == 1) {
+        run_section_generation(context);
+    } else if (phase == 2) {
+        run_section_assignment(context);
+    } else if (phase == 3) {
+        run_coastline_smoothing(context);
+    } else {
+        run_biome_generation(context);
+    }
+
+    // Set Section Completion Time
+
+    struct timespec time_now;
+    clock_gettime(CLOCK_REALTIME, &time_now);
+    context->section_times[phase] = (float)(time_now.tv_sec - context->start_time.tv_sec) +
+        (time_now.tv_nsec - context->start_time.tv_nsec) / 1000000000.0 -
+        sum_list_float(context->section_times, 7);
+
+}
+
+/**
+ * Generate a map of CONFIG in CONTEXT, and render VIEW of it (or the whole map,
+ * if VIEW is null) to IMAGE in FORMAT, as a palette png if PALETTE. Free IMAGE
+ * with free_image. Pixel counts of each type are left in CONTEXT's type counts.
+ * Return false, without generating anything, for tiles, which aren't one file.
+ */
+bool generate_map(
+    MapContext *context, const MapConfig *config, const OutputFormat format, const bool palette,
+    const View *view, MapImage *image
+) {
+
+    if (format == FORMAT_TILES) {
+        return false;
+    }
+
+    start_map(context, config);
+    for (int phase = 1; phase < 5; phase++) {
+        run_phase(context, phase);
+    }
+
+    const View whole_map = {0, 0, config->width, config->height, 1};
+    render_map(
+        context, NULL, format, palette, (view != NULL) ? view : &whole_map, NULL, NULL,
+        context->type_counts, image
+    );
+
+    return true;
+
+}
+
+/**
+ * Fill STATS with the statistics of CONTEXT's map, from its dots' Voronoi
+ * cells: the area of each type, and its islands and water bodies, the regions
+ * of land or water cells joined by shared edges, with their areas and
+ * coastlines. Workers compute the cells and join them in a union-find forest
+ * they share, and the regions are counted once they're done. Free STATS with
+ * free_map_stats.
+ */
+void get_map_stats(MapContext *context, MapStats *stats) {
+
+    const int width = context->config.width;
+    const int height = context->config.height;
+    const int processes = context->config.processes;
+    const int num_dots = context->num_dots;
+    const Dot *dots = context->dots;
+
+    int fork_pids[processes];
+
+    // Create Dots KDTree
+
+    int *dot_coords = malloc(num_dots * 3 * sizeof(int));
+    for (int i = 0; i < num_dots; i++) {
+        dot_coords[i * 3] = dots[i].x;
+        dot_coords[i * 3 + 1] = dots[i].y;
+        dot_coords[i * 3 + 2] = i;
+    }
+    Node *tree_root = build_recursive(dot_coords, num_dots, 0);
+    free(dot_coords);
+
+    // Join Cells Into Regions
+
+    _Atomic int *parents = map_shared(num_dots * sizeof(int));
+    double *areas = map_shared(num_dots * sizeof(double));
+    double *coastlines = map_shared(num_dots * sizeof(double));
+    for (int i = 0; i < num_dots; i++) {
+        atomic_init(&parents[i], i);
+    }
+
+    int piece_length = num_dots / processes;
+    int piece_starts[processes + 1];
+    for (int i = 0; i < processes; i++) {
+        piece_starts[i] = i * piece_length;
+    }
+    piece_starts[processes] = num_dots;
+
+    fflush(NULL); // Forks would otherwise repeat buffered output on exit
+    for (int i = 0; i < processes; i++) {
+
+        fork_pids[i] = fork();
+        if (fork_pids[i] != 0) {
+            continue;
+        }
+
+        set_process_title("worker", i);
+        join_regions(
+            piece_starts[i], piece_starts[i + 1], tree_root, num_dots, dots, width, height,
+            parents, areas, coastlines
+        );
+        exit(0);
+
+    }
+    for (int i = 0; i < processes; i++) {
+        waitpid(fork_pids[i], NULL, 0);
+    }
+
+    // Count Regions
+    // Each region is numbered by its lowest dot, so the regions don't depend on the workers
+
+    *stats = (MapStats){0};
+    stats->regions = malloc(num_dots * sizeof(Region));
+    int *root_regions = malloc(num_dots * sizeof(int));
+
+    for (int i = 0; i < num_dots; i++) {
+        const int root = find_root_shared(parents, i);
+        if (root == i) {
+            root_regions[i] = stats->num_regions++;
+            stats->regions[root_regions[i]] = (Region){
+                .is_land = is_land_type(dots[i].type), .first_dot = i
+            };
+        }
+        // Roots are the lowest dot of their set, so are always numbered first
+        Region *region = &stats->regions[root_regions[root]];
+        region->num_dots++;
+        region->area += areas[i];
+        region->coastline += coastlines[i];
+
+        const int type_index = get_type_index(dots[i].type);
+        if (type_index < 11) {
+            stats->type_areas[type_index] += areas[i];
+        }
+        if (region->is_land) {
+            stats->land_area += areas[i];
+            stats->coastline += coastlines[i];
+        } else {
+            stats->water_area += areas[i];
+        }
+    }
+
+    qsort(stats->regions, stats->num_regions, sizeof(Region), compare_regions);
+    for (int i = 0; i < stats->num_regions; i++) {
+        stats->num_islands += stats->regions[i].is_land;
+    }
+
+    // Free Regions Memory and Tree
+
+    free(root_regions);
+    unmap_shared(parents, num_dots * sizeof(int));
+    unmap_shared(areas, num_dots * sizeof(double));
+    unmap_shared(coastlines, num_dots * sizeof(double));
+    free_recursive(tree_root);
+
+}
+
+/**
+ * Free STATS, filled by get_map_stats.
+ */
+void free_map_stats(MapStats *stats) {
+    free(stats->regions);
+}
+
+/**
+ * Free IMAGE, an output rendered to memory.
+ */
+void free_image(MapImage *image) {
+    if (image->shared) {
+        unmap_shared(image->data, image->size);
+    } else {
+        free(image->data);
+    }
+}
+
+/**
+ * Free CONTEXT's memory.
+ */
+void free_context(MapContext *context) {
+
+    if (context->dots != NULL) {
+        unmap_shared(context->dots, sizeof(Dot) * context->dots_capacity);
+    }
+    free(context->dot_order);
+    unmap_shared(context->section_progress, sizeof(int) * 8);
+    unmap_shared(context->section_progress_total, sizeof(int) * 8);
+    unmap_shared(context->section_times, sizeof(float) * 8);
+    unmap_shared(context->type_counts, sizeof(long) * 11);
+
+}
@@ -0,0 +1,234 @@
+/*
+Copyright (C) 2025 Liam Ralph
+https://github.com/liam-ralph
+
+This program, including this file, is licensed under the
+GNU General Public License v3.0 (GNU GPLv3), with one exception.
+See LICENSE or this project's source for more information.
+Project Source: https://github.com/liam-ralph/biomegen
+
+result.png, the output of this program, is licensed under The Unlicense.
+See LICENSE_PNG or this project's source for more information.
+
+The BiomeGen library's interface. Functions are documented where they're
+defined, in biomegen.c.
+
+To generate a map in memory, call init_context once, then generate_map for
+each map, e.g.
+
+    MapContext context;
+    init_context(&context);
+    MapConfig config = {
+        1920, 1080, 100, 120, 5.0, 5, 8, 1234, DISTRIBUTION_UNIFORM, SMOOTHING_NEAREST, 1
+    };
+    MapImage image;
+    generate_map(&context, &config, FORMAT_PNG, false, NULL, &image);
+    // image.data holds image.size bytes of png
+    free_image(&image);
+    free_context(&context);
+
+Phases can also be run one at a time with start_map and run_phase, then the
+map rendered to a file with render_map, as main.c does.
+*/
+
+#ifndef BIOMEGEN_H
+#define BIOMEGEN_H
+
+
+// Includes
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+
+// Definitions
+
+#define VERSION "3.2.0" // Part of cache keys, so update (with README.md) when maps change
+
+
+// Structs
+
+typedef struct {
+    int x;
+    int y;
+    char type;
+    /*
+    I = Ice
+    s = Shallow Water
+    W = Water
+    d = Deep Water
+
+    R = Rock
+    D = Desert
+    J = Jungle
+    F = Forest
+    P = Plains
+    T = Taiga
+    S = Snow
+
+    w = Water Forced
+    L = Land
+    l = Land Origin
+    */
+} Dot;
+
+typedef struct {
+    int x; // Top left map pixel
+    int y;
+    int width; // Size in map pixels
+    int height;
+    double scale; // Output pixels per map pixel
+} View;
+
+typedef struct {
+    int *indexes; // Nearest dot of each pixel, row by row
+    int width;
+    int height;
+} IndexGrid;
+
+typedef enum {
+    DISTRIBUTION_UNIFORM, // Random pixels without repeats (see place_dots)
+    DISTRIBUTION_JITTERED // One dot in each cell of a grid (see place_dots_jittered)
+} Distribution;
+
+typedef enum {
+    SMOOTHING_NEAREST, // Nearest dots of each type (see smooth_coastlines)
+    SMOOTHING_DENSITY // Blurred dot counts (see smooth_coastlines_density)
+} SmoothingMethod;
+
+typedef enum {
+    FORMAT_PNG,
+    FORMAT_PPM, // Binary (P6) ppm, written in place
+    FORMAT_QOI,
+    FORMAT_RAW, // Type index per pixel after a 16 byte header, written in place
+    FORMAT_TILES, // Directory of 256x256 png tiles for every zoom level
+    FORMAT_SVG, // Biome polygons, merged from the dots' Voronoi cells
+    FORMAT_GEOJSON
+} OutputFormat;
+
+typedef struct {
+    char magic[6]; // "BGDOTS"
+    short version; // 1
+    int dot_size; // sizeof(Dot), which must match to read the dots
+    int phase; // Last phase completed (see get_phase)
+    int width;
+    int height;
+    int map_resolution;
+    int island_abundance;
+    int island_size; // 10 times island size, as passed in arguments
+    int coastline_smoothing;
+    unsigned int seed; // Map seed (see get_random)
+    int num_dots;
+    int distribution; // How dots were placed (see Distribution)
+    int smoothing_method; // How coastlines were smoothed (see SmoothingMethod)
+    int smoothing_passes; // Times coastlines were smoothed
+    int reserved[1]; // Pads the header to 64 bytes
+} CheckpointHeader;
+
+typedef struct {
+    int width;
+    int height;
+    int map_resolution;
+    int island_abundance;
+    float island_size;
+    int coastline_smoothing;
+    int processes; // Workers used by each phase
+    unsigned int seed;
+    Distribution distribution;
+    SmoothingMethod smoothing_method;
+    int smoothing_passes; // Times coastlines are smoothed, usually 1
+} MapConfig;
+
+typedef struct {
+    MapConfig config;
+    int num_dots;
+    Dot *dots; // Shared with workers
+    int dots_capacity; // Dots there is memory for
+    int *dot_order; // Dot indexes in scanline order, null until run_phase needs it
+    struct timespec start_time; // Section times are measured from this
+    // Shared with workers and the progress tracker, indexed by section
+    _Atomic int *section_progress;
+    int *section_progress_total;
+    float *section_times; // The last is the total time, set by the caller
+    long *type_counts; // Pixels of each type index (see get_type_index)
+} MapContext;
+
+typedef struct {
+    // Land or water cells joined by shared edges (see get_map_stats)
+    bool is_land;
+    int num_dots;
+    int first_dot; // Lowest index of its dots
+    double area; // Pixels
+    double coastline; // Length of its edges with cells of the other kind, in pixels
+} Region;
+
+typedef struct {
+    double type_areas[11]; // Pixels of each type index (see get_type_index), after biomes
+    double land_area; // Pixels
+    double water_area;
+    double coastline; // Length of every edge between land and water cells, in pixels
+    Region *regions; // Islands and water bodies, largest first
+    int num_regions;
+    int num_islands;
+} MapStats;
+
+typedef struct {
+    unsigned char *data; // The whole output file, e.g. a png or a ppm's header and pixels
+    size_t size;
+    bool shared; // In shared memory (in-place formats), not from malloc
+} MapImage;
+
+
+// General Functions
+
+int get_distribution(const char name[]);
+int get_smoothing_method(const char name[]);
+void *map_shared(const size_t size);
+float sum_list_float(const float list[], const int list_len);
+void unmap_shared(void *map, const size_t size);
+
+
+// Output Functions
+
+int get_output_format(const char name[]);
+
+
+// Checkpoint Functions
+
+int get_phase(const char name[]);
+void write_checkpoint(
+    const char path[], CheckpointHeader *header, const int phase, const Dot *dots
+);
+bool read_checkpoint_header(const char path[], CheckpointHeader *header);
+bool read_checkpoint_dots(const char path[], Dot *dots);
+
+
+// Multiprocessing Functions
+
+void set_process_title(const char type[], const int num);
+void sleep_ns(const long nanoseconds);
+void render_map(
+    MapContext *context, const char output_file[], const OutputFormat format,
+    const bool palette, const View *view, const IndexGrid *coarse, IndexGrid *nearest,
+    long *type_counts, MapImage *image
+);
+
+
+// Context Functions
+
+void init_context(MapContext *context);
+void start_map(MapContext *context, const MapConfig *config);
+void run_phase(MapContext *context, const int phase);
+bool generate_map(
+    MapContext *context, const MapConfig *config, const OutputFormat format, const bool palette,
+    const View *view, MapImage *image
+);
+void get_map_stats(MapContext *context, MapStats *stats);
+void free_map_stats(MapStats *stats);
+void free_image(MapImage *image);
+void free_context(MapContext *context);
+
+
+#endif
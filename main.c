@@ -18,20 +18,23 @@ BiomeGen, a terminal application for generating png maps.
 
 #define _POSIX_C_SOURCE 199309L // Needed for CLOCK_REALTIME
 
+#include <dirent.h>
+#include <fcntl.h>
 #include <limits.h>
 #include <math.h>
-#include <png.h>
 #include <stdatomic.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/mman.h>
-#include <sys/prctl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
 #include <sys/wait.h>
 #include <time.h>
 #include <unistd.h>
 
+#include "biomegen.h"
+
 
 // Definitions
 
@@ -40,39 +43,6 @@ BiomeGen, a terminal application for generating png maps.
 #define ANSI_RESET "\033[0m"
 
 
-// Structs
-
-typedef struct {
-    short x;
-    short y;
-    char type;
-    /*
-    I = Ice
-    s = Shallow Water
-    W = Water
-    d = Deep Water
-
-    R = Rock
-    D = Desert
-    J = Jungle
-    F = Forest
-    P = Plains
-    T = Taiga
-    S = Snow
-
-    w = Water Forced
-    L = Land
-    l = Land Origin
-    */
-} Dot;
-
-typedef struct Node {
-    int coord[2];
-    int index;
-    struct Node *left;
-    struct Node *right;
-} Node;
-
 // General Functions
 // (Alphabetical order)
 
@@ -102,374 +72,382 @@ int get_int(const int min, const int max) {
 }
 
 /**
- * Return the sum of a list of integers.
- */
-int sum_list_int(const int list[], const int list_len) {
-    int sum = 0;
-    for (int i = 0; i < list_len; i++) {
-        sum += list[i];
-    }
-    return sum;
-}
-
-/**
- * Return the sum of a list of floats.
+ * Return the 64-bit FNV-1a hash of STRING.
  */
-float sum_list_float(const float list[], const int list_len) {
-    float sum = 0;
-    for (int i = 0; i < list_len; i++) {
-        sum += list[i];
+unsigned long hash_string(const char string[]) {
+    unsigned long hash = 14695981039346656037UL;
+    for (int i = 0; string[i] != '\0'; i++) {
+        hash = (hash ^ (unsigned char)string[i]) * 1099511628211UL;
     }
-    return sum;
+    return hash;
 }
 
-void quicksort_recursive(int *coords, const int low, const int high, const int width) {
-
-    if (low < high) {
-
-        /*
-        Pivot value is the value at coords[high]. Every value less than pivot
-        will be to the left of wherever pivot ends up. Remember: a coord is
-        {x, y, index (of equivalent dot in dots)}. The array isn't 2D as it
-        requires malloc.
-        */
-        int pivot = coords[high * 3 + 1] * width + coords[high * 3];
-
-        // Move Smaller Elements to the Left
-
-        int i = low - 1;
-
-        for (int ii = low; ii <= high - 1; ii++) {
-            if (coords[ii * 3 + 1] * width + coords[ii * 3] < pivot) {
-                i++;
-                const int temp[3] = {coords[i * 3], coords[i * 3 + 1], coords[i * 3 + 2]};
-                coords[i * 3] = coords[ii * 3];
-                coords[i * 3 + 1] = coords[ii * 3 + 1];
-                coords[i * 3 + 2] = coords[ii * 3 + 2];
-                coords[ii * 3] = temp[0];
-                coords[ii * 3 + 1] = temp[1];
-                coords[ii * 3 + 2] = temp[2];
-            }
-        }
-
-        // Move Pivot to After Smaller Elements
 
-        i++;
-        const int temp[3] = {coords[i * 3], coords[i * 3 + 1], coords[i * 3 + 2]};
-        coords[i * 3] = coords[high * 3];
-        coords[i * 3 + 1] = coords[high * 3 + 1];
-        coords[i * 3 + 2] = coords[high * 3 + 2];
-        coords[high * 3] = temp[0];
-        coords[high * 3 + 1] = temp[1];
-        coords[high * 3 + 2] = temp[2];
-
-        // Decide Whether Recursion is Needed
-        /*
-        Cases:
-        i == med_index, the median is in the correct spot, no more sorting
-        i > med_index, median is in left section, left section needs sorting
-        i < med_index, median in right section, sort right section
-        */
+// Cache Functions
+/*
+The cache is a directory of finished outputs and the dots they were made from,
+named after a hash of everything that went into them (see hash_string). An
+identical request is served from the cache instead of being generated again.
+Entries are added under a temporary name and renamed into place, so other
+processes only ever see complete entries, and the least recently used entries
+are removed when the cache is over its size limit.
+*/
 
-        quicksort_recursive(coords, low, i - 1, width);
-        quicksort_recursive(coords, i + 1, high, width);
+/**
+ * Copy the file at SOURCE to DESTINATION. Return whether it was copied.
+ */
+bool copy_file(const char source[], const char destination[]) {
 
+    FILE *source_fptr = fopen(source, "r");
+    if (source_fptr == NULL) {
+        return false;
+    }
+    FILE *destination_fptr = fopen(destination, "w");
+    if (destination_fptr == NULL) {
+        fclose(source_fptr);
+        return false;
     }
 
-}
+    char buffer[65536];
+    size_t size;
+    bool copied = true;
+    while ((size = fread(buffer, 1, sizeof(buffer), source_fptr)) > 0) {
+        copied = copied && fwrite(buffer, 1, size, destination_fptr) == size;
+    }
 
+    fclose(source_fptr);
+    return fclose(destination_fptr) == 0 && copied;
 
-// KDTree Functions
+}
 
 /**
- * Sort the given COORDS until the median index is correctly sorted. In other
- * words, median index will be correct, everything before median index will be
- * less than the value at median index, and everything after will be greater.
- * AXIS determines which value of a coordinate is its value (x or y) to sort
- * based on. HIGH and LOW determine the sorting bounds for a given level of
- * recursion.
+ * Write the path of the cache entry for KEY in CACHE_DIR to PATH, a buffer of
+ * 300 characters, with EXTENSION (e.g. ".dots") added to it.
  */
-void median_sort_recursive(
-    int *coords, const int low, const int high, const int axis, const int med_index
+void get_cache_path(
+    const char cache_dir[], const unsigned long key, const char extension[], char path[]
 ) {
+    snprintf(path, 300, "%s/%016lx%s", cache_dir, key, extension);
+}
 
-    if (low < high) {
-
-        /*
-        Pivot value is the value at coords[high]. Every value less than pivot
-        will be to the left of wherever pivot ends up. Remember: a coord is
-        {x, y, index (of equivalent dot in dots)}. The array isn't 2D as it
-        requires malloc.
-        */
-        int pivot = coords[high * 3 + axis];
-
-        // Move Smaller Elements to the Left
-
-        int i = low - 1;
-
-        for (int ii = low; ii <= high - 1; ii++) {
-            if (coords[ii * 3 + axis] < pivot) {
-                i++;
-                const int temp[3] = {coords[i * 3], coords[i * 3 + 1], coords[i * 3 + 2]};
-                coords[i * 3] = coords[ii * 3];
-                coords[i * 3 + 1] = coords[ii * 3 + 1];
-                coords[i * 3 + 2] = coords[ii * 3 + 2];
-                coords[ii * 3] = temp[0];
-                coords[ii * 3 + 1] = temp[1];
-                coords[ii * 3 + 2] = temp[2];
-            }
-        }
-
-        // Move Pivot to After Smaller Elements
-
-        i++;
-        const int temp[3] = {coords[i * 3], coords[i * 3 + 1], coords[i * 3 + 2]};
-        coords[i * 3] = coords[high * 3];
-        coords[i * 3 + 1] = coords[high * 3 + 1];
-        coords[i * 3 + 2] = coords[high * 3 + 2];
-        coords[high * 3] = temp[0];
-        coords[high * 3 + 1] = temp[1];
-        coords[high * 3 + 2] = temp[2];
+/**
+ * Serve OUTPUT_FILE from the cache entry at CACHE_PATH, as a hard link to the
+ * entry, a copy if a link can't be made, or written to stdout if OUTPUT_FILE is
+ * "-". The entry is marked as used for eviction. Return whether it was served.
+ */
+bool fetch_cached(const char cache_path[], const char output_file[]) {
 
-        // Decide Whether Recursion is Needed
-        /*
-        Cases:
-        i == med_index, the median is in the correct spot, no more sorting
-        i > med_index, median is in left section, left section needs sorting
-        i < med_index, median in right section, sort right section
-        */
+    if (utimensat(AT_FDCWD, cache_path, NULL, 0) != 0) {
+        return false; // Not cached, or evicted
+    }
 
-        if (i > med_index) {
-            median_sort_recursive(coords, low, i - 1, axis, med_index);
-        } else if (i < med_index) {
-            median_sort_recursive(coords, i + 1, high, axis, med_index);
+    if (strcmp(output_file, "-") == 0) {
+        FILE *fptr = fopen(cache_path, "r");
+        if (fptr == NULL) {
+            return false;
         }
-
+        char buffer[65536];
+        size_t size;
+        while ((size = fread(buffer, 1, sizeof(buffer), fptr)) > 0) {
+            fwrite(buffer, 1, size, stdout);
+        }
+        fclose(fptr);
+        fflush(stdout);
+        return true;
     }
 
+    unlink(output_file);
+    return link(cache_path, output_file) == 0 || copy_file(cache_path, output_file);
+
 }
 
 /**
- * Build a KDTree from COORDS, and return the root node. Ensures the KDTree is
- * built with the lowest possible depth for maximum efficiency when querying the
- * tree. Every recursion creates one dot and calls this function to insert its
- * children from an array of possible dots. DEPTH should be 0. COORDS should be
- * of length NUM_COORDS * 3.
+ * Add the file at SOURCE to the cache in CACHE_DIR, as the entry at
+ * CACHE_PATH. It is linked (or copied) under a temporary name first, then
+ * renamed into place, so the entry appears complete or not at all.
  */
-Node *build_recursive(int *coords, const int num_coords, const int depth) {
-
-    const int med_pos = num_coords / 2;
-
-    // Sort Coords Around Median Position
-    /*
-    Median coord will be in correct place, everything less will be to the left,
-    everything else to the right.
-    */
+void insert_cached(const char cache_dir[], const char cache_path[], const char source[]) {
 
-    median_sort_recursive(coords, 0, num_coords - 1, depth % 2, med_pos);
+    char temp_path[300];
+    snprintf(temp_path, 300, "%s/.temp-%d", cache_dir, getpid());
 
-    // Add Median Node to Tree
-    // Every recursion adds one node
-
-    Node *node = malloc(sizeof(Node));
-    node->coord[0] = coords[med_pos * 3];
-    node->coord[1] = coords[med_pos * 3 + 1];
-    node->index = coords[med_pos * 3 + 2];
-    node->left = NULL;
-    node->right = NULL;
+    unlink(temp_path);
+    if (link(source, temp_path) == 0 || copy_file(source, temp_path)) {
+        rename(temp_path, cache_path);
+    }
+    unlink(temp_path);
 
-    // Decide whether node will have a left child
+}
 
-    const int num_coords_left = med_pos;
+/**
+ * Compare cache entries A and B, {last use time, size} pairs, for qsort, so
+ * the least recently used come first.
+ */
+int compare_cache_entries(const void *a, const void *b) {
+    const long time_a = ((const long *)a)[0];
+    const long time_b = ((const long *)b)[0];
+    return (time_a > time_b) - (time_a < time_b);
+}
 
-    if (num_coords_left > 0) {
+/**
+ * Remove the least recently used entries of the cache in CACHE_DIR until it
+ * holds at most MAX_SIZE bytes. Processes evict one at a time.
+ */
+void evict_cache(const char cache_dir[], const long max_size) {
+
+    char path[300];
+    snprintf(path, 300, "%s/.lock", cache_dir);
+    const int lock_fd = open(path, O_RDWR | O_CREAT, 0644);
+    flock(lock_fd, LOCK_EX);
+
+    // List Entries
+    // Each entry is {last use time, size, index in names}
+
+    DIR *dir = opendir(cache_dir);
+    int num_entries = 0;
+    int max_entries = 64;
+    long *entries = malloc(max_entries * 3 * sizeof(long));
+    char (*names)[256] = malloc(max_entries * 256);
+    long total_size = 0;
+
+    struct dirent *dir_entry;
+    while (dir != NULL && (dir_entry = readdir(dir)) != NULL) {
+
+        struct stat entry_stat;
+        snprintf(path, 300, "%s/%s", cache_dir, dir_entry->d_name);
+        if (dir_entry->d_name[0] == '.' || stat(path, &entry_stat) != 0) {
+            continue; // Lock, temporary entries, and directories
+        }
 
-        int *coords_left = malloc(num_coords_left * 3 * sizeof(int));
-        for (int i = 0; i < med_pos; i++) {
-            coords_left[i * 3] = coords[i * 3];
-            coords_left[i * 3 + 1] = coords[i * 3 + 1];
-            coords_left[i * 3 + 2] = coords[i * 3 + 2];
+        if (num_entries == max_entries) {
+            max_entries *= 2;
+            entries = realloc(entries, max_entries * 3 * sizeof(long));
+            names = realloc(names, max_entries * 256);
         }
-        node->left = build_recursive(coords_left, num_coords_left, depth + 1);
-        free(coords_left);
+        entries[num_entries * 3] = entry_stat.st_mtime;
+        entries[num_entries * 3 + 1] = entry_stat.st_size;
+        entries[num_entries * 3 + 2] = num_entries;
+        strncpy(names[num_entries], dir_entry->d_name, 256);
+        total_size += entry_stat.st_size;
+        num_entries++;
 
-        // Decide whether node will have a right child
+    }
+    if (dir != NULL) {
+        closedir(dir);
+    }
 
-        const int num_coords_right = num_coords - med_pos - 1;
+    // Remove Least Recently Used Entries
 
-        if (num_coords_right > 0) {
-            int *coords_right = malloc(num_coords_right * 3 * sizeof(int));
-            for (int i = 0; i < num_coords_right; i++) {
-                const int index = i + med_pos + 1;
-                coords_right[i * 3] = coords[index * 3];
-                coords_right[i * 3 + 1] = coords[index * 3 + 1];
-                coords_right[i * 3 + 2] = coords[index * 3 + 2];
-            }
-            node->right = build_recursive(coords_right, num_coords_right, depth + 1);
-            free(coords_right);
+    qsort(entries, num_entries, 3 * sizeof(long), compare_cache_entries);
+    for (int i = 0; i < num_entries && total_size > max_size; i++) {
+        snprintf(path, 300, "%s/%s", cache_dir, names[entries[i * 3 + 2]]);
+        if (unlink(path) == 0) {
+            total_size -= entries[i * 3 + 1];
         }
-
     }
 
-    // Return node to place it within the tree
-    return node;
+    free(entries);
+    free(names);
+    flock(lock_fd, LOCK_UN);
+    close(lock_fd);
 
 }
 
-/**
- * Query the KDTree to modify MIN_DIST, the distance to the nearest node. When
- * INDEX_PTR is not null, it stores the index of the nearest node, which
- * corresponds to the index of the dot it was created from. Calls itself
- * recursively to query children of NODE. DEPTH should be 0 when NODE is a root
- * node.
- */
-void query_recursive(
-    Node *node, const int coord[2], const int depth, int *index_ptr, int *min_dist_ptr
-) {
-
-    // Calculate Distance
-
-    const int diff_x = node->coord[0] - coord[0];
-    const int diff_y = node->coord[1] - coord[1];
-    // Distance is squared for efficiency
-    const int dist = diff_x * diff_x + diff_y * diff_y;
 
-    // Update Minimum Distance and Index Pointers
+// Sweep Functions
+/*
+Sweeps work like checkpoints in memory: the phases before a swept parameter is
+used run once, and each value continues from their dots.
+*/
 
-    if (dist < *min_dist_ptr) {
-        *min_dist_ptr = dist;
-        if (index_ptr != NULL) {
-            *index_ptr = node->index;
-        } else if (dist < 15 * 15) {
-            return; // Shortcut specifically for water biome generation
-        }
+/**
+ * Return the phase that first uses the parameter named NAME ("island_size" or
+ * "coastline_smoothing"), for sweeps, or -1 for a parameter that can't be
+ * swept.
+ */
+int get_sweep_phase(const char name[]) {
+    if (strcmp(name, "island_size") == 0) {
+        return 2;
+    } else if (strcmp(name, "coastline_smoothing") == 0) {
+        return 3;
     }
+    return -1;
+}
 
-    // Decide Whether Recursion is Needed
-
-    const int axis = depth % 2;
+/**
+ * Add SUFFIX to PATH, a buffer of 229 characters, before its extension if it
+ * has one. e.g. "maps/result.png" becomes "maps/result_5.png" for "_5".
+ */
+void add_path_suffix(char path[], const char suffix[]) {
 
-    const int dist_line = node->coord[axis] - coord[axis];
-    const int dist_sq = dist_line * dist_line;
-    // Whether distance to splitting line is less than max_dist
-    if (node->left != NULL && (dist_sq < *min_dist_ptr || coord[axis] < node->coord[axis])) {
-        /*
-        Recursion only if coord is close enough to dividing line, or coord would
-        be inside bounds of left child
-        */
-        query_recursive(node->left, coord, depth + 1, index_ptr, min_dist_ptr);
-    }
-    if (node->right != NULL && (dist_sq < *min_dist_ptr || coord[axis] >= node->coord[axis])) {
-        query_recursive(node->right, coord, depth + 1, index_ptr, min_dist_ptr);
+    char *extension = strrchr(path, '.');
+    if (extension == NULL || strchr(extension, '/') != NULL) {
+        extension = path + strlen(path);
     }
 
+    char rest[229];
+    strncpy(rest, extension, 229);
+    snprintf(extension, 229 - (extension - path), "%s%s", suffix, rest);
+
 }
 
 /**
- * Query the KDTree to modify DISTS, the distances of the nearest DISTS_LEN
- * points to COORD. Recursively navigates down the KDTree, editing DISTS and
- * the value at MAX_DIST_PTR whenever it finds a node whose distance is less
- * than the value at MAX_DIST_PTR. All distances are squared for efficiency.
- * DEPTH should be 0 when NODE is a root node.
+ * Start one run of a sweep over the values FIRST to LAST, both inclusive, of a
+ * parameter, after the phases shared by every run. Each value but the last is
+ * run in turn by a forked process, while this process waits, then runs the
+ * last value itself. Return the value for the calling process to run.
+ * Forked runs get their own copy of CONTEXT's dots, so they don't change the
+ * dots of the runs after them. CONTEXT's start time is moved forward by the
+ * time spent waiting on earlier runs, so each run's time is the shared phases
+ * plus its own. The value is added to every path of the run: OUTPUT_FILE,
+ * the NUM_EXTRA_OUTPUTS EXTRA_FILES, the CHECKPOINT_FILES of phases from
+ * SWEEP_PHASE on, and STATS_FILE (see add_path_suffix).
  */
-void query_dist_recursive(
-    Node *node, const int coord[2], const int depth,
-    int dists[], const int dists_len
+int start_sweep_run(
+    const int first, const int last, MapContext *context, const int sweep_phase, char output_file[],
+    char extra_files[][229], const int num_extra_outputs, char checkpoint_files[][229],
+    char stats_file[]
 ) {
 
-    // Calculate Distance
+    struct timespec wait_start;
+    clock_gettime(CLOCK_REALTIME, &wait_start);
 
-    const int diff_x = node->coord[0] - coord[0];
-    const int diff_y = node->coord[1] - coord[1];
-    const int dist = diff_x * diff_x + diff_y * diff_y; // Squared distance
+    // Fork a Run for Each Value
 
-    // Update Distances List
+    int value = first;
+    bool forked = false;
 
-    if (dist < dists[dists_len - 1] && dist != 0) {
-        for (int i = dists_len - 1; i >= 0; i--) {
-            if (i == 0 || dist >= dists[i - 1]) {
-                // Found insertion position, insert and break
-                dists[i] = dist;
-                break;
-            }
-            // After insertion position, shift element
-            dists[i] = dists[i - 1];
+    fflush(NULL);
+    for (; value < last; value++) {
+        const int pid = fork();
+        if (pid == 0) {
+            forked = true;
+            break;
         }
+        waitpid(pid, NULL, 0);
     }
 
-    // Decide Whether Recursion is Needed
+    // Skip Time Spent Waiting
 
-    const int axis = depth % 2;
+    struct timespec time_now;
+    clock_gettime(CLOCK_REALTIME, &time_now);
+    struct timespec *start_time = &context->start_time;
+    long start_ns = start_time->tv_sec * 1000000000L + start_time->tv_nsec +
+        (time_now.tv_sec - wait_start.tv_sec) * 1000000000L +
+        (time_now.tv_nsec - wait_start.tv_nsec);
+    start_time->tv_sec = start_ns / 1000000000L;
+    start_time->tv_nsec = start_ns % 1000000000L;
+
+    // Copy Dots
+
+    if (forked) {
+        Dot *dots = map_shared(sizeof(Dot) * context->num_dots);
+        memcpy(dots, context->dots, sizeof(Dot) * context->num_dots);
+        context->dots = dots;
+        context->dots_capacity = context->num_dots;
+    }
 
-    const int dist_line = node->coord[axis] - coord[axis];
-    const int dist_sq = dist_line * dist_line;
-    // Whether distance to splitting line is less than max_dist
-    if (node->left != NULL && (dist_sq < dists[dists_len - 1] || coord[axis] < node->coord[axis])) {
-        /*
-        Recursion only if coord is close enough to dividing line, or coord would
-        be inside bounds of left child
-        */
-        query_dist_recursive(node->left, coord, depth + 1, dists, dists_len);
+    // Add Value to Paths
+
+    char suffix[16];
+    snprintf(suffix, 16, "_%d", value);
+    if (strcmp(output_file, "-") != 0) {
+        add_path_suffix(output_file, suffix);
+    }
+    for (int i = 0; i < num_extra_outputs; i++) {
+        add_path_suffix(extra_files[i], suffix);
+    }
+    for (int i = sweep_phase; i < 5; i++) {
+        if (checkpoint_files[i][0] != '\0') {
+            add_path_suffix(checkpoint_files[i], suffix);
+        }
     }
-    if (
-        node->right != NULL && (dist_sq < dists[dists_len - 1] || coord[axis] >= node->coord[axis])
-    ) {
-        query_dist_recursive(node->right, coord, depth + 1, dists, dists_len);
+    if (stats_file[0] != '\0') {
+        add_path_suffix(stats_file, suffix);
     }
 
+    return value;
+
 }
 
+
+// Statistics Functions
+/*
+Statistics are written as JSON, so maps can be filtered by other programs
+without reading the image. Areas and lengths are in pixels, from the dots'
+Voronoi cells (see get_map_stats), and regions are listed largest first.
+*/
+
 /**
- * Recursively free NODE and its children.
+ * Write the regions of STATS that are land if IS_LAND, or water otherwise, to
+ * FPTR as a JSON object of their count and a list of their sizes.
  */
-void free_recursive(Node *node) {
-    if (node->left != NULL) {
-        free_recursive(node->left);
-    }
-    if (node->right != NULL) {
-        free_recursive(node->right);
+void write_stats_regions(FILE *fptr, const MapStats *stats, const bool is_land) {
+    fprintf(
+        fptr, "{\"count\":%d,\"regions\":[",
+        is_land ? stats->num_islands : stats->num_regions - stats->num_islands
+    );
+    bool first = true;
+    for (int i = 0; i < stats->num_regions; i++) {
+        const Region *region = &stats->regions[i];
+        if (region->is_land != is_land) {
+            continue;
+        }
+        fprintf(
+            fptr, "%s{\"area\":%.2f,\"dots\":%d,\"coastline\":%.2f}",
+            first ? "" : ",", region->area, region->num_dots, region->coastline
+        );
+        first = false;
     }
-    free(node);
-    node = NULL;
+    fprintf(fptr, "]}");
 }
 
-
-// Multiprocessing Functions
-// (Order of use)
-
 /**
- * Set the process's title to "biogen-" + TYPE. If NUM >= 0, then NUM, padded to
- * a length of 2 (not including null character) with leading zeros will be added
- * as well. The length of TYPE + NUM (as a string) must be at max 9 characters
- * (including null character).
+ * Write STATS, the statistics of CONTEXT's map, to the file at PATH as JSON.
+ * The area of each type is only written if BIOMES have been generated. Return
+ * whether it was written.
  */
-void set_process_title(const char type[], const int num) {
-
-    // Example: type is "worker", num is 6: "biogen-worker6"
-
-    // Concatenate Type
-
-    char string[16] = "biogen-";
-    strncat(string, type, 9);
-
-    // Concatenate Num
+bool write_stats(
+    const char path[], const MapContext *context, const MapStats *stats, const bool biomes
+) {
 
-    if (0 <= num && num < 100) {
-        char num_str[3];
-        snprintf(num_str, 3, "%02d", num);
-        strncat(string, num_str, 3);
+    FILE *fptr = fopen(path, "w");
+    if (fptr == NULL) {
+        return false;
     }
 
-    // Set Process Title
+    const char types[11][14] = {
+        "Ice", "Shallow Water", "Water", "Deep Water",
+        "Rock", "Desert", "Jungle", "Forest", "Plains", "Taiga", "Snow"
+    };
+    fprintf(
+        fptr, "{\"width\":%d,\"height\":%d,\"seed\":%u,\"dots\":%d,",
+        context->config.width, context->config.height, context->config.seed, context->num_dots
+    );
+    fprintf(
+        fptr, "\"water_area\":%.2f,\"land_area\":%.2f,\"coastline\":%.2f,",
+        stats->water_area, stats->land_area, stats->coastline
+    );
+    if (biomes) {
+        fprintf(fptr, "\"types\":{");
+        for (int i = 0; i < 11; i++) {
+            fprintf(fptr, "%s\"%s\":%.2f", (i == 0) ? "" : ",", types[i], stats->type_areas[i]);
+        }
+        fprintf(fptr, "},");
+    }
+    fprintf(fptr, "\"islands\":");
+    write_stats_regions(fptr, stats, true);
+    fprintf(fptr, ",\"water_bodies\":");
+    write_stats_regions(fptr, stats, false);
+    fprintf(fptr, "}\n");
 
-    #ifdef __linux__
-        prctl(PR_SET_NAME, string, 0, 0, 0);
-    #elif BSD || __Apple__
-        setproctitle(string);
-    #endif
+    return fclose(fptr) == 0;
 
 }
 
+
+// Multiprocessing Functions
+
 /**
  * Track the progress of map generation, and show the progress in the terminal.
  * START_TIME is the time at the start of map generation in main(), and the
@@ -485,7 +463,7 @@ void track_progress(
         "Setup", "Section Generation", "Section Assignment", "Coastline Smoothing",
         "Biome Generation", "Image Generation", "Finish"
     };
-    float section_weights[7] = {0.03, 0.01, 0.01, 0.14, 0.04, 0.24, 0.53};
+    float section_weights[7] = {0.03, 0.01, 0.01, 0.14, 0.04, 0.72, 0.05};
     // Used for overall progress bar (e.g. Setup takes ~3% of total time)
 
     while (true) {
@@ -584,356 +562,8 @@ void track_progress(
 
         // Sleep 0.1 Seconds
 
-        struct timespec sleep_time;
-        sleep_time.tv_sec = 0;
-        sleep_time.tv_nsec = 100000000;
-        nanosleep(&sleep_time, &sleep_time);
-
-    }
-
-}
-
-/**
- * Assign sections of the map. Land and water are randomly assigned based on a
- * dot's distance from the nearest land origin dot.
- */
-void assign_sections(
-    const int map_resolution, const float island_size,
-    const int start_index, const int end_index, const int *reg_dots,
-    Node *origin_tree_root, Dot *dots, _Atomic int *section_progress
-) {
-
-    srand(time(NULL) + getpid());
-
-    int min_dist;
-
-    for (int i = start_index; i < end_index; i++) {
-    // Non-water dots are not included
-
-        // Calculate Maximum Distance
-
-        if (i != start_index && reg_dots[i * 3 + 1] == reg_dots[(i - 1) * 3 + 1]) {
-            int min_dist_sq = (int)sqrt(min_dist) + 1 + reg_dots[i * 3] - reg_dots[(i - 1) * 3];
-            min_dist = min_dist_sq * min_dist_sq;
-        } else {
-            min_dist = INT_MAX;
-        }
-
-        // Find Distance to Nearest Origin Dot
-
-        // min and dist are squared, sqrt is not done until later
-        int min_index = 0;
-        int coord[2] = {reg_dots[i * 3], reg_dots[i * 3 + 1]};
-        query_recursive(origin_tree_root, coord, 0, &min_index, &min_dist);
-
-        // Calculate Chance
-
-        float dist = sqrt(min_dist) / sqrt(map_resolution);
-        float threshold = ((float)(min_index % 20) / 19.0f * 1.5f + 0.25f) * island_size;
-
-        int chance = (dist <= threshold) ? 9 : 1;
-
-        if (rand() % 10 < chance) {
-            dots[reg_dots[i * 3 + 2]].type = 'L'; // Land
-        }
-
-        atomic_fetch_add(&section_progress[2], 1);
-
-    }
-
-}
-
-/**
- * Smooth map coastlines for a more realistic, aesthetically pleasing map.
- * Reassigns land and water dots based on the average distance of the nearest
- * COASTLINE_SMOOTHING dots of the same and opposite types.
- */
-void smooth_coastlines(
-    const int coastline_smoothing,
-    const int *land_dots, const int land_start, const int land_end, Node *land_tree_root,
-    const int *water_dots, const int water_start, const int water_end, Node *water_tree_root,
-    const int num_dots, const int num_land_dots, const int num_water_dots,
-    Dot *dots, _Atomic int *section_progress
-) {
-
-    int dists_same[coastline_smoothing];
-    int dists_opp[coastline_smoothing];
-
-    // Coastline Smoothing for Land Dots
-
-    for (int i = land_start; i < land_end; i++) {
-
-        int dot_coord[2] = {land_dots[i * 3], land_dots[i * 3 + 1]};
-
-        // Calculate Maximum Distances
-
-        bool same_y = (i != land_start && land_dots[i * 3 + 1] == land_dots[(i - 1) * 3 + 1]);
-        if (same_y) {
-            const int prev_dot_dist = land_dots[i * 3] - land_dots[(i - 1) * 3];
-            int min_dist_same = (int)sqrt(dists_same[coastline_smoothing - 1]) + 1 + prev_dot_dist;
-            // + 1 needed for floating-point errors (ceil didn't work)
-            min_dist_same *= min_dist_same;
-            int min_dist_opp = (int)sqrt(dists_opp[coastline_smoothing - 1]) + 1 + prev_dot_dist;
-            min_dist_opp *= min_dist_opp;
-            for (int ii = 0; ii < coastline_smoothing; ii++) {
-                dists_same[ii] = min_dist_same;
-                dists_opp[ii] = min_dist_opp;
-            }
-        } else {
-            for (int ii = 0; ii < coastline_smoothing; ii++) {
-                dists_same[ii] = INT_MAX;
-            }
-        }
-
-        // Get Nearest Distances for Each Type
-
-        long sum_same = 0;
-        long sum_opp = 0;
-
-        query_dist_recursive(land_tree_root, dot_coord, 0, dists_same, coastline_smoothing);
-        for (int ii = 0; ii < coastline_smoothing; ii++) {
-            sum_same += dists_same[ii];
-        }
-
-        if (!same_y) {
-            const int max = (sum_same < INT_MAX) ? sum_same : INT_MAX;
-            for (int ii = 0; ii < coastline_smoothing; ii++) {
-                dists_opp[ii] = max;
-            }
-        }
-
-        query_dist_recursive(water_tree_root, dot_coord, 0, dists_opp, coastline_smoothing);
-        for (int ii = 0; ii < coastline_smoothing; ii++) {
-            sum_opp += dists_opp[ii];
-        }
-
-        // Change Dot Type if Closer to Opposite Type
-
-        if (sum_same > sum_opp) {
-            dots[land_dots[i * 3 + 2]].type = 'W';
-        }
-
-        atomic_fetch_add(&section_progress[3], 1);
-
-    }
-
-    // Coastline Smoothing for Water Dots
-
-    for (int i = water_start; i < water_end; i++) {
-
-        int dot_coord[2] = {water_dots[i * 3], water_dots[i * 3 + 1]};
-
-        // Calculate Maximum Distances
-
-        bool same_y = (i != water_start && water_dots[i * 3 + 1] == water_dots[(i - 1) * 3 + 1]);
-        if (same_y) {
-            const int prev_dot_dist = water_dots[i * 3] - water_dots[(i - 1) * 3];
-            int min_dist_same = (int)sqrt(dists_same[coastline_smoothing - 1]) + 1 + prev_dot_dist;
-            min_dist_same *= min_dist_same;
-            int min_dist_opp = (int)sqrt(dists_opp[coastline_smoothing - 1]) + 1 + prev_dot_dist;
-            min_dist_opp *= min_dist_opp;
-            for (int ii = 0; ii < coastline_smoothing; ii++) {
-                dists_same[ii] = min_dist_same;
-                dists_opp[ii] = min_dist_opp;
-            }
-        } else {
-            for (int ii = 0; ii < coastline_smoothing; ii++) {
-                dists_same[ii] = INT_MAX;
-            }
-        }
-
-        // Get Nearest Distances for Each Type
-
-        long sum_same = 0;
-        long sum_opp = 0;
-
-        query_dist_recursive(water_tree_root, dot_coord, 0, dists_same, coastline_smoothing);
-        for (int ii = 0; ii < coastline_smoothing; ii++) {
-            sum_same += dists_same[ii];
-        }
-
-        if (!same_y) {
-            const int max = (sum_same < INT_MAX) ? sum_same : INT_MAX;
-            for (int ii = 0; ii < coastline_smoothing; ii++) {
-                dists_opp[ii] = max;
-            }
-        }
-
-        query_dist_recursive(land_tree_root, dot_coord, 0, dists_opp, coastline_smoothing);
-        for (int ii = 0; ii < coastline_smoothing; ii++) {
-            sum_opp += dists_opp[ii];
-        }
-
-        // Change Dot Type if Closer to Opposite Type
-
-        if (sum_same > sum_opp) {
-            dots[water_dots[i * 3 + 2]].type = 'L';
-        }
-
-        atomic_fetch_add(&section_progress[3], 1);
-
-    }
-
-}
-
-/**
- * Generate water biomes for DOTS between START_INDEX and END_INDEX. Water
- * biomes are generated based on a dot's distance to the equator and the
- * distance to the nearest land dot.
- */
-void generate_biomes_water(
-    const int start_index, const int end_index, const int *water_dots, Node *land_tree_root,
-    const int height, const int num_dots, Dot *dots, _Atomic int *section_progress
-) {
-
-    int land_dist;
-
-    for (int i = start_index; i < end_index; i++) {
-
-        // Calculate Distance to Equator
-
-        const float equator_dist =
-            fabs((float)water_dots[i * 3 + 1] - height / 2.0) / height * 20.0;
-
-        // Calculate Maximum Land Distance
-
-        if (i != start_index && water_dots[i * 3 + 1] == water_dots[(i - 1) * 3 + 1]) {
-            int min_dist_sq =
-                (int)sqrt(land_dist) + 1 + water_dots[i * 3] - water_dots[(i - 1) * 3];
-            land_dist = min_dist_sq * min_dist_sq;
-        } else {
-            land_dist = INT_MAX;
-        }
-
-        // Calculate Distance to Land
-
-        const int coord[2] = {water_dots[i * 3], water_dots[i * 3 + 1]};
-        query_recursive(land_tree_root, coord, 0, NULL, &land_dist);
-
-        // Set Water Biome
-
-        char dot_type = 'W';
-        if ( // Remember: all land distances are squared for efficiency
-            (land_dist < 35 * 35 && equator_dist > 9) ||
-            (land_dist < 25 * 25 && equator_dist > 8) ||
-            (land_dist < 15 * 15 && equator_dist > 7)
-        ) {
-            dot_type = 'I';
-        } else if (land_dist < 18 * 18) {
-            dot_type = 's';
-        } else if (land_dist >= 35 * 35) {
-            dot_type = 'd';
-        }
-
-        dots[water_dots[i * 3 + 2]].type = dot_type;
-
-        atomic_fetch_add(&section_progress[4], 1);
-
-    }
-
-}
-
-/**
- * Generate land biomes for DOTS between START_INDEX and END_INDEX. Land biomes
- * are generated base on the nearest dot in BIOME_ORIGIN_INDEXES, the list of
- * dots whose biomes are already before this function.
- */
-void generate_biomes_land(
-    const int start_index, const int end_index, const int *land_dots,
-    Node *origin_tree_root, const int biome_origin_indexes[],
-    const int num_dots, Dot *dots, _Atomic int *section_progress
-) {
-
-    int min_dist;
-
-    for (int i = start_index; i < end_index; i++) {
-
-        // Calculate Maxminum Distance
-
-        if (i != start_index && land_dots[i * 3 + 1] == land_dots[(i - 1) * 3 + 1]) {
-            int min_dist_sq = (int)sqrt(min_dist) + 1 + land_dots[i * 3] - land_dots[(i - 1) * 3];
-            min_dist = min_dist_sq * min_dist_sq;
-        } else {
-            min_dist = INT_MAX;
-        }
-
-        // Find Nearest Biome Origin Dot
-
-        int origin_index = 0;
-        const int coord[2] = {land_dots[i * 3], land_dots[i * 3 + 1]};
-        query_recursive(origin_tree_root, coord, 0, &origin_index, &min_dist);
-
-        // Set Dot Type
-
-        dots[land_dots[i * 3 + 2]].type = dots[origin_index].type;
-
-        atomic_fetch_add(&section_progress[4], 1);
-
-    }
-
-}
-
-/**
- * Generate a section of the IMAGE_INDEXES, which contains the index in DOTS of
- * the nearest dot to each pixel. Also count the number of pixels of each type
- * for TYPE_COUNTS, to be used in statistics at the end of the main program.
- */
-void generate_image(
-    const int start_height, const int end_height, const int width, Node *tree_root,
-    const int num_dots, const Dot *dots,
-    int *image_indexes, int *type_counts, _Atomic int *section_progress
-) {
-
-    // Dot type counts for statistics, not used in image generation
-    int local_type_counts[11] = {0};
-    const char types[11] = {'I', 's', 'W', 'd', 'R', 'D', 'J', 'F', 'P', 'T', 'S'};
-
-    // Generate Image
-
-    for (int y = start_height; y < end_height; y++) {
-
-        int min_dist = INT_MAX;
-
-        for (int x = 0; x < width; x++) {
-
-            int nearest_index = 0;
-
-            if (min_dist != INT_MAX) {
-                const int min_dist_sq = (int)sqrt(min_dist) + 2;
-                /*
-                max_dist = dist(previous x, previous nearest dot) + dist(previous x, current x)
-                         = previous max_dist + 1
-                +1 for floating point errors (ceil didn't work)
-                */
-                min_dist = min_dist_sq * min_dist_sq;
-            }
-
-            // Find Nearest Dot
-
-            const int coord[2] = {x, y};
-            query_recursive(tree_root, coord, 0, &nearest_index, &min_dist);
-
-            // Add to Image Indexes and Local Type Counts
-
-            image_indexes[y * width + x] = nearest_index;
-            for (int i = 0; i < 11; i++) {
-                if (dots[nearest_index].type == types[i]) {
-                    local_type_counts[i]++;
-                    break;
-                }
-            }
-
-        }
-
-        // Only update for each row of pixels
-        atomic_fetch_add(&section_progress[5], 1);
-
-    }
-
-    // Update Shared Type Counts
+        sleep_ns(100000000);
 
-    for (int i = 0; i < 11; i++) {
-        type_counts[i] += local_type_counts[i];
     }
 
 }
@@ -953,6 +583,27 @@ int main(int argc, char *argv[]) {
     // Get Inputs
 
     bool auto_mode;
+    bool palette = false;
+    OutputFormat output_format = FORMAT_PNG;
+    char checkpoint_files[5][229] = {{0}}; // Checkpoint to write after each phase, if any
+    char resume_file[229] = "";
+    CheckpointHeader resume_header;
+    int resume_phase = 0; // Last phase loaded from a checkpoint
+    int stop_phase = 6; // Last phase to run, 6 for all of them
+    View view = {0, 0, -1, -1, 1}; // Whole map unless set
+    char extra_files[8][229];
+    double extra_scales[8];
+    int num_extra_outputs = 0;
+    bool preview = false;
+    int sweep_phase = 0; // Phase that first uses the swept parameter, 0 for no sweep
+    int sweep_first = 0, sweep_last = 0;
+    long seed_option = -1; // Seed for the map, -1 for one from the time
+    Distribution distribution = DISTRIBUTION_UNIFORM;
+    SmoothingMethod smoothing_method = SMOOTHING_NEAREST;
+    int smoothing_passes = 1;
+    char stats_file[229] = ""; // Statistics output, if any
+    char cache_dir[229] = ""; // Cache directory, if any
+    long cache_size = 1024; // Cache size limit, in MiB
     char output_file[229];
     int width, height, map_resolution, island_abundance, coastline_smoothing, processes;
     float island_size;
@@ -965,19 +616,6 @@ int main(int argc, char *argv[]) {
 
         strncpy(output_file, "result.png", 11);
 
-        // Get Program Version
-
-        char file_line[29];
-        FILE *fptr = fopen("README.md", "r");
-        fgets(file_line, 29, fptr);
-        fgets(file_line, 29, fptr);
-        fgets(file_line, 29, fptr);
-        fclose(fptr);
-
-        char version[12];
-        strncpy(version, file_line + 12, 12);
-        version[strlen(version) - 1] = '\0';
-
         // Copyright, license notice, etc.
         system("clear");
         printf(
@@ -988,7 +626,7 @@ int main(int argc, char *argv[]) {
             "except for result.png, this program's output, licensed under The Unlicense.\n"
             "\033[38;5;1mWARNING: In some terminals, the refreshing progress screen\n"
             "may flash, which could cause problems for people with epilepsy.%s\n"
-            "Press ENTER to begin.\n", version, ANSI_RESET
+            "Press ENTER to begin.\n", VERSION, ANSI_RESET
         );
         /*
         I do not know if the flashing lights this program sometimes makes could reasonably cause
@@ -999,10 +637,10 @@ int main(int argc, char *argv[]) {
         system("clear");
 
         printf("Map Width (pixels):\n");
-        width = get_int(500, 10000);
+        width = get_int(500, 100000);
 
         printf("\nMap Height:\n");
-        height = get_int(500, 10000);
+        height = get_int(500, 100000);
 
         printf(
             "\nMap resolution controls the section size of the map.\n"
@@ -1051,6 +689,9 @@ int main(int argc, char *argv[]) {
         );
         processes = get_int(1, 64); // Change this for CPUs with >64 threads
 
+        view.width = width;
+        view.height = height;
+
         system("clear");
 
     } else {
@@ -1066,738 +707,443 @@ int main(int argc, char *argv[]) {
         island_size = atoi(argv[5]) / 10.0;
         coastline_smoothing = atoi(argv[6]);
         processes = atoi(argv[7]);
+        if (strlen(argv[8]) >= 229) {
+            fprintf(stderr, "Output path \"%s\" is too long.\n", argv[8]);
+            return 1;
+        }
         strncpy(output_file, argv[8], 229);
 
-    }
-
-    struct timespec start_time;
-    clock_gettime(CLOCK_REALTIME, &start_time);
-
-    // --Setup--
-
-    // Shared Memory
-
-    _Atomic int *section_progress = mmap(
-        NULL, sizeof(int) * 7, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0
-    );
-
-    int *section_progress_total = mmap(
-        NULL, sizeof(int) * 7, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0
-    );
-
-    float *section_times = mmap(
-        NULL, sizeof(float) * 8, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0
-    );
-
-    for (int i = 0; i < 8; i++) {
-        atomic_init(&section_progress[i], 0);
-        section_progress_total[i] = 1;
-        section_times[i] = 0;
-    }
-
-    const int num_dots = width * height / map_resolution;
-
-    Dot *dots = mmap(
-        NULL, sizeof(Dot) * num_dots, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0
-    );
-
-    int *image_indexes = mmap(
-        NULL, sizeof(int) * width * height,
-        PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0
-    );
-
-    for (int i = 0; i < width * height; i++) {
-        image_indexes[i] = 0;
-    }
-
-    int *type_counts = mmap(
-        NULL, sizeof(int) * 11, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0
-    );
-
-    int tracker_process_pid = -1;
-
-    if (!auto_mode) {
-
-        // Progress Tracking
+        // Optional Arguments
 
-        tracker_process_pid = fork();
-
-        if (tracker_process_pid == 0) {
-            set_process_title("tracker", -1);
-            track_progress(start_time, section_progress, section_progress_total, section_times);
-            exit(0);
+        for (int i = 9; i < argc; i++) {
+            if (strcmp(argv[i], "--palette") == 0) {
+                palette = true;
+            } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+                const int format = get_output_format(argv[++i]);
+                if (format == -1) {
+                    fprintf(stderr, "Unknown format \"%s\".\n", argv[i]);
+                    return 1;
+                }
+                output_format = format;
+            } else if (strcmp(argv[i], "--checkpoint") == 0 && i + 2 < argc) {
+                const int phase = get_phase(argv[++i]);
+                if (phase == -1) {
+                    fprintf(stderr, "Unknown phase \"%s\".\n", argv[i]);
+                    return 1;
+                }
+                strncpy(checkpoint_files[phase], argv[++i], 229);
+            } else if (strcmp(argv[i], "--resume") == 0 && i + 1 < argc) {
+                strncpy(resume_file, argv[++i], 229);
+            } else if (strcmp(argv[i], "--view") == 0 && i + 4 < argc) {
+                view.x = atoi(argv[++i]);
+                view.y = atoi(argv[++i]);
+                view.width = atoi(argv[++i]);
+                view.height = atoi(argv[++i]);
+            } else if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+                view.scale = atof(argv[++i]);
+            } else if (strcmp(argv[i], "--also") == 0 && i + 2 < argc && num_extra_outputs < 8) {
+                strncpy(extra_files[num_extra_outputs], argv[++i], 229);
+                extra_scales[num_extra_outputs++] = atof(argv[++i]);
+            } else if (strcmp(argv[i], "--preview") == 0) {
+                preview = true;
+            } else if (strcmp(argv[i], "--sweep") == 0 && i + 3 < argc) {
+                sweep_phase = get_sweep_phase(argv[++i]);
+                if (sweep_phase == -1) {
+                    fprintf(stderr, "Unknown sweep parameter \"%s\".\n", argv[i]);
+                    return 1;
+                }
+                sweep_first = atoi(argv[++i]);
+                sweep_last = atoi(argv[++i]);
+            } else if (strcmp(argv[i], "--distribution") == 0 && i + 1 < argc) {
+                const int distribution_option = get_distribution(argv[++i]);
+                if (distribution_option == -1) {
+                    fprintf(stderr, "Unknown distribution \"%s\".\n", argv[i]);
+                    return 1;
+                }
+                distribution = distribution_option;
+            } else if (strcmp(argv[i], "--smoothing") == 0 && i + 1 < argc) {
+                const int smoothing_option = get_smoothing_method(argv[++i]);
+                if (smoothing_option == -1) {
+                    fprintf(stderr, "Unknown smoothing method \"%s\".\n", argv[i]);
+                    return 1;
+                }
+                smoothing_method = smoothing_option;
+            } else if (strcmp(argv[i], "--smoothing-passes") == 0 && i + 1 < argc) {
+                smoothing_passes = atoi(argv[++i]);
+            } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+                seed_option = strtoul(argv[++i], NULL, 10) & UINT_MAX;
+            } else if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {
+                strncpy(stats_file, argv[++i], 229);
+            } else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+                strncpy(cache_dir, argv[++i], 229);
+            } else if (strcmp(argv[i], "--cache-size") == 0 && i + 1 < argc) {
+                cache_size = atol(argv[++i]);
+            } else if (strcmp(argv[i], "--stop-after") == 0 && i + 1 < argc) {
+                stop_phase = get_phase(argv[++i]);
+                if (stop_phase == -1) {
+                    fprintf(stderr, "Unknown phase \"%s\".\n", argv[i]);
+                    return 1;
+                }
+            } else {
+                fprintf(stderr, "Unknown argument \"%s\".\n", argv[i]);
+                return 1;
+            }
         }
 
-    }
-
-    // Set Section Completion Time
-
-    struct timespec time_now;
-    clock_gettime(CLOCK_REALTIME, &time_now);
-    section_times[0] = (float)(time_now.tv_sec - start_time.tv_sec) +
-        (time_now.tv_nsec - start_time.tv_nsec) / 1000000000.0;
-    atomic_store(&section_progress[0], 1);
-
-    // --Section Generation--
-    // Create the initial list of dots
-
-    section_progress_total[1] = num_dots;
-
-    srand(time(NULL));
-
-    const int num_special_dots = num_dots / island_abundance * 2;
-    const int num_reg_dots = num_dots - num_special_dots;
-
-    bool *used_coords = calloc(width * height, sizeof(bool));
-
-    for (int i = 0; i < num_dots; i++) {
-
-        // Find Unused Coordinate
-
-        int ii;
-        do {
-            ii = rand() % (width * height);
-        } while (used_coords[ii]);
-
-        // Create Dot
-
-        used_coords[ii] = true;
-
-        Dot new_dot = { .x = ii % width, .y = ii / width };
-        if (i < num_special_dots / 2) {
-            new_dot.type = 'l'; // Land Origin, origin points for islands
-        } else if (i < num_special_dots) {
-            new_dot.type = 'w'; // Water Forced (good for making lakes)
-        } else {
-            new_dot.type = 'W'; // Water (default)
+        if (
+            (output_format == FORMAT_PPM || output_format == FORMAT_RAW ||
+            output_format == FORMAT_TILES) && strcmp(output_file, "-") == 0
+        ) {
+            fprintf(stderr, "ppm, raw, and tiles outputs are written by workers.\n");
+            return 1;
         }
 
-        dots[i] = new_dot;
-
-        atomic_fetch_add(&section_progress[1], 1);
-
-    }
-
-    free(used_coords);
-
-    // Set Section Completion Time
-
-    clock_gettime(CLOCK_REALTIME, &time_now);
-    section_times[1] = (float)(time_now.tv_sec - start_time.tv_sec) +
-        (time_now.tv_nsec - start_time.tv_nsec) / 1000000000.0 - sum_list_float(section_times, 7);
-
-    // --Section Assignment--
-    // Assign dots as "Land", "Land Origin", "Water", or "Water Forced"
-
-    section_progress_total[2] = num_reg_dots;
-
-    // Create Land Origin KDTree
-
-    const int num_origin_dots = num_special_dots / 2;
-    int *land_origin_dots = malloc(num_origin_dots * 3 * sizeof(int));
-    for (int i = 0; i < num_origin_dots; i++) {
-        Dot *dot = &dots[i];
-        land_origin_dots[i * 3] = dot->x;
-        land_origin_dots[i * 3 + 1] = dot->y;
-        land_origin_dots[i * 3 + 2] = i;
-    }
-    Node *origin_tree_root = NULL;
-    origin_tree_root = build_recursive(land_origin_dots, num_origin_dots, 0);
-    free(land_origin_dots);
-
-    // Create and Sort Regular Dots
-
-    int *reg_dots = malloc(num_reg_dots * 3 * sizeof(int));
-    for (int i = num_special_dots; i < num_dots; i++) {
-        Dot *dot = &dots[i];
-        const int index = i - num_special_dots;
-        reg_dots[index * 3] = dot->x;
-        reg_dots[index * 3 + 1] = dot->y;
-        reg_dots[index * 3 + 2] = i;
-    }
-
-    // Create Regular Piece Starts
+        // Load Checkpoint Parameters
+        /*
+        The map's dots come from the checkpoint, along with the parameters of
+        the phases that made them. Parameters of later phases still come from
+        the arguments.
+        */
 
-    int reg_piece_length = num_reg_dots / processes;
-    int reg_piece_starts[processes + 1];
-    for (int i = 0; i < processes; i++) {
-        reg_piece_starts[i] = i * reg_piece_length;
-    }
-    reg_piece_starts[processes] = num_reg_dots;
-    /*
-    used to create x pieces of size num_reg_dots / x, where x = processes
-    last piece may be larger, special dots are skipped
-    */
+        if (resume_file[0] != '\0') {
 
-    // Run Workers
+            if (!read_checkpoint_header(resume_file, &resume_header)) {
+                fprintf(stderr, "Couldn't read checkpoint \"%s\".\n", resume_file);
+                return 1;
+            }
 
-    int fork_pids[processes]; // Create forks list
-    for (int i = 0; i < processes; i++) {
+            resume_phase = resume_header.phase;
+            width = resume_header.width;
+            height = resume_header.height;
+            map_resolution = resume_header.map_resolution;
+            island_abundance = resume_header.island_abundance;
+            distribution = resume_header.distribution;
+            if (resume_phase >= 2) {
+                island_size = resume_header.island_size / 10.0;
+            }
+            if (resume_phase >= 3) {
+                coastline_smoothing = resume_header.coastline_smoothing;
+                smoothing_method = resume_header.smoothing_method;
+                smoothing_passes = resume_header.smoothing_passes;
+            }
 
-        fork_pids[i] = fork(); // Create fork
-        if (fork_pids[i] != 0) {
-            continue;
         }
 
-        // e.g. biogen-worker00
-        set_process_title("worker", i);
-        assign_sections( // Run worker
-            map_resolution, island_size, reg_piece_starts[i], reg_piece_starts[i + 1], reg_dots,
-            origin_tree_root, dots, section_progress
-        );
-        exit(0); // Kill worker
-
-    }
-    for (int i = 0; i < processes; i++) {
-        waitpid(fork_pids[i], NULL, 0); // Wait for workers
-    }
-
-    // Free Regular Dots and Land Origin Tree
-
-    free(reg_dots);
-    free_recursive(origin_tree_root);
-
-    // Set Section Completion Time
-
-    clock_gettime(CLOCK_REALTIME, &time_now);
-    section_times[2] = (float)(time_now.tv_sec - start_time.tv_sec) +
-        (time_now.tv_nsec - start_time.tv_nsec) / 1000000000.0 - sum_list_float(section_times, 7);
-
-    // --Coastline Smoothing--
-
-    if (coastline_smoothing != 0) {
-
-        section_progress_total[3] = num_reg_dots;
-
-        // Create Land and Water Dots
-
-        int num_land_dots = 0;
-        int num_water_dots = 0;
-        int *land_dots = malloc(num_reg_dots * 3 * sizeof(int));
-        int *water_dots = malloc(num_reg_dots * 3 * sizeof(int));
-        // num_land_dots + num_water_dots == num_reg_dots, so this is the max
-
-        for (int i = num_special_dots; i < num_dots; i++) {
-        // Only includes "Land" and "Water" dots
-            const Dot *dot = &dots[i];
-            if (dot->type == 'L') {
-                land_dots[num_land_dots * 3] = dot->x;
-                land_dots[num_land_dots * 3 + 1] = dot->y;
-                land_dots[num_land_dots * 3 + 2] = i;
-                num_land_dots++;
-            } else {
-                water_dots[num_water_dots * 3] = dot->x;
-                water_dots[num_water_dots * 3 + 1] = dot->y;
-                water_dots[num_water_dots * 3 + 2] = i;
-                num_water_dots++;
+        for (int i = 1; i < 5; i++) {
+            if (checkpoint_files[i][0] != '\0' && (i <= resume_phase || i > stop_phase)) {
+                fprintf(stderr, "Checkpoints must be after a phase that is run.\n");
+                return 1;
             }
         }
-
-        // Create Land and Water KDTrees
-
-        Node *land_tree_root = NULL;
-        Node *water_tree_root = NULL;
-
-        land_tree_root = build_recursive(land_dots, num_land_dots, 0);
-        water_tree_root = build_recursive(water_dots, num_water_dots, 0);
-
-        // Sort Land and Water Dots
-
-        quicksort_recursive(land_dots, 0, num_land_dots - 1, width);
-        quicksort_recursive(water_dots, 0, num_water_dots - 1, width);
-
-        // Create Piece Starts for Land and Water Dots
-
-        int land_piece_length = num_land_dots / processes;
-        int land_piece_starts[processes + 1];
-        for (int i = 0; i < processes; i++) {
-            land_piece_starts[i] = i * land_piece_length;
+        if (stop_phase <= resume_phase) {
+            fprintf(stderr, "The checkpoint is already past the phase to stop after.\n");
+            return 1;
         }
-        land_piece_starts[processes] = num_land_dots;
-
-        int water_piece_length = num_water_dots / processes;
-        int water_piece_starts[processes + 1];
-        for (int i = 0; i < processes; i++) {
-            water_piece_starts[i] = i * water_piece_length;
+        if (
+            sweep_phase != 0 &&
+            (sweep_phase <= resume_phase || sweep_phase > stop_phase || sweep_first > sweep_last)
+        ) {
+            fprintf(stderr, "Sweeps must be over a parameter of a phase that is run.\n");
+            return 1;
         }
-        water_piece_starts[processes] = num_water_dots;
 
-        // Run Workers
+        // Check View
 
-        for (int i = 0; i < processes; i++) {
+        if (view.width == -1) {
+            view.width = width;
+            view.height = height;
+        }
+        bool scales_valid = view.scale > 0;
+        for (int i = 0; i < num_extra_outputs; i++) {
+            scales_valid = scales_valid && extra_scales[i] > 0 && strcmp(extra_files[i], "-") != 0;
+        }
+        if (
+            view.x < 0 || view.y < 0 || view.width < 1 || view.height < 1 ||
+            view.x + view.width > width || view.y + view.height > height || !scales_valid
+        ) {
+            fprintf(stderr, "Views must be inside the map, at a positive scale.\n");
+            return 1;
+        }
+        if (
+            (output_format == FORMAT_SVG || output_format == FORMAT_GEOJSON) &&
+            (view.width != width || view.height != height || view.scale != 1 ||
+            num_extra_outputs != 0 || preview)
+        ) {
+            fprintf(stderr, "Vector outputs are always the whole map.\n");
+            return 1;
+        }
+        if (preview && output_format == FORMAT_TILES) {
+            fprintf(stderr, "Tiles can't be previewed.\n");
+            return 1;
+        }
 
-            fork_pids[i] = fork();
-            if (fork_pids[i] != 0) {
-                continue;
-            }
+        // Check Cache Options
+        /*
+        Only whole runs of a fixed seed can be found in the cache again, and
+        checkpoints and tiles would be skipped when they are.
+        */
 
-            set_process_title("worker", i);
-            smooth_coastlines(
-                coastline_smoothing,
-                land_dots, land_piece_starts[i], land_piece_starts[i + 1], land_tree_root,
-                water_dots, water_piece_starts[i], water_piece_starts[i + 1], water_tree_root,
-                num_dots, num_land_dots, num_water_dots, dots, section_progress
+        bool checkpoints_set = false;
+        for (int i = 1; i < 5; i++) {
+            checkpoints_set = checkpoints_set || checkpoint_files[i][0] != '\0';
+        }
+        if (
+            cache_dir[0] != '\0' &&
+            (seed_option == -1 || resume_file[0] != '\0' || sweep_phase != 0 ||
+            stop_phase != 6 || checkpoints_set || output_format == FORMAT_TILES || preview)
+        ) {
+            fprintf(
+                stderr,
+                "Cached runs need a seed, and can't use checkpoints, sweeps, tiles, or previews.\n"
             );
-            exit(0);
-
+            return 1;
         }
-        for (int i = 0; i < processes; i++) {
-            waitpid(fork_pids[i], NULL, 0);
+        if (cache_dir[0] != '\0') {
+            mkdir(cache_dir, 0755);
         }
 
-        // Free Dot Lists and Trees
-
-        free(land_dots);
-        free(water_dots);
-
-        free_recursive(land_tree_root);
-        free_recursive(water_tree_root);
-
-    } else {
-
-        // Coastline smoothing would have no effect
-        atomic_store(&section_progress[3], 1);
-
     }
 
-    // Set Section Completion Time
+    struct timespec start_time;
+    clock_gettime(CLOCK_REALTIME, &start_time);
 
-    clock_gettime(CLOCK_REALTIME, &time_now);
-    section_times[3] = (float)(time_now.tv_sec - start_time.tv_sec) +
-        (time_now.tv_nsec - start_time.tv_nsec) / 1000000000.0 - sum_list_float(section_times, 7);
+    // --Cache Lookup--
+    /*
+    Every output is served from the cache if they're all there. Otherwise the
+    dots, if cached, are loaded like a checkpoint of the biomes phase, and only
+    the image is generated. Keys hash everything that changes the result, which
+    doesn't include the process count.
+    */
 
-    // --Biome Generation--
+    unsigned long generation_key = 0;
+    unsigned long output_keys[9]; // Main output, then extra outputs
+    char cache_path[300];
+    bool outputs_cached = false; // Statistics still need the dots
 
-    atomic_store(&section_progress_total[4], num_dots);
+    if (cache_dir[0] != '\0') {
 
-    // Remove "Land Origin" and "Water Forced" Dots
+        char key_string[300];
+        snprintf(
+            key_string, 300, "biomegen %s %d %d %d %d %d %d %ld %d %d %d", VERSION,
+            width, height, map_resolution, island_abundance, (int)round(island_size * 10),
+            coastline_smoothing, seed_option, distribution, smoothing_method, smoothing_passes
+        );
+        generation_key = hash_string(key_string);
 
-    for (int i = 0; i < num_special_dots; i++) {
-        Dot *dot = &dots[i];
-        if (dot->type == 'l') {
-            dot->type = 'L';
-        } else if (dot->type == 'w') {
-            dot->type = 'W';
+        bool all_cached = true;
+        for (int i = 0; i <= num_extra_outputs; i++) {
+            View output_view = view;
+            if (i != 0) {
+                output_view.scale = extra_scales[i - 1];
+            }
+            snprintf(
+                key_string, 300, "%016lx %d %d %d %d %d %d %.17g", generation_key,
+                output_format, palette, output_view.x, output_view.y,
+                output_view.width, output_view.height, output_view.scale
+            );
+            output_keys[i] = hash_string(key_string);
+            get_cache_path(cache_dir, output_keys[i], "", cache_path);
+            all_cached = all_cached && access(cache_path, R_OK) == 0;
         }
-    }
-
-    // Create Water Biomes
-    // Adds ice, depth
-
-    // Build Land Dots KDTree
-
-    int num_land_dots = 0;
-    int num_water_dots = 0;
-    int *land_dots = malloc(num_dots * 3 * sizeof(int));
-    int *water_dots = malloc(num_dots * 3 * sizeof(int));
 
-    for (int i = 0; i < num_dots; i++) {
-        const Dot *dot = &dots[i];
-        if (dots[i].type == 'L') {
-            land_dots[num_land_dots * 3] = dot->x;
-            land_dots[num_land_dots * 3 + 1] = dot->y;
-            land_dots[num_land_dots * 3 + 2] = i;
-            num_land_dots++;
-        } else {
-            water_dots[num_water_dots * 3] = dot->x;
-            water_dots[num_water_dots * 3 + 1] = dot->y;
-            water_dots[num_water_dots * 3 + 2] = i;
-            num_water_dots++;
+        // Extra outputs first, as the main output may already be on stdout
+        for (int i = num_extra_outputs; i >= 0 && all_cached; i--) {
+            get_cache_path(cache_dir, output_keys[i], "", cache_path);
+            all_cached = fetch_cached(cache_path, (i == 0) ? output_file : extra_files[i - 1]);
         }
-    }
-
-    Node *land_tree_root = NULL;
-    land_tree_root = build_recursive(land_dots, num_land_dots, 0);
-    free(land_dots);
-
-    // Sort Water Dots
 
-    quicksort_recursive(water_dots, 0, num_water_dots - 1, width);
+        outputs_cached = all_cached;
+        if (all_cached && stats_file[0] == '\0') {
+            struct timespec end_time;
+            clock_gettime(CLOCK_REALTIME, &end_time);
+            fprintf(
+                strcmp(output_file, "-") == 0 ? stderr : stdout, "%f\n",
+                (float)(end_time.tv_sec - start_time.tv_sec) +
+                (end_time.tv_nsec - start_time.tv_nsec) / 1000000000.0
+            );
+            return 0;
+        }
 
-    // Create Piece Starts Water Dots
+        get_cache_path(cache_dir, generation_key, ".dots", cache_path);
+        if (
+            utimensat(AT_FDCWD, cache_path, NULL, 0) == 0 &&
+            read_checkpoint_header(cache_path, &resume_header)
+        ) {
+            strncpy(resume_file, cache_path, 229);
+            resume_phase = resume_header.phase;
+        }
 
-    int water_piece_length = num_water_dots / processes;
-    int water_piece_starts[processes + 1];
-    for (int i = 0; i < processes; i++) {
-        water_piece_starts[i] = i * water_piece_length;
     }
-    water_piece_starts[processes] = num_water_dots;
 
-    // Run Workers
+    // --Setup--
 
-    for (int i = 0; i < processes; i++) {
+    // Random numbers are drawn from this, so resumed runs match full runs
+    const MapConfig config = {
+        .width = width, .height = height, .map_resolution = map_resolution,
+        .island_abundance = island_abundance, .island_size = island_size,
+        .coastline_smoothing = coastline_smoothing, .processes = processes,
+        .seed = (resume_phase != 0) ? resume_header.seed :
+            (seed_option != -1) ? seed_option : time(NULL),
+        .distribution = distribution, .smoothing_method = smoothing_method,
+        .smoothing_passes = smoothing_passes
+    };
 
-        fork_pids[i] = fork();
-        if (fork_pids[i] != 0) {
-            continue;
-        }
+    MapContext context;
+    init_context(&context);
+    start_map(&context, &config);
 
-        set_process_title("worker", i);
-        generate_biomes_water(
-            water_piece_starts[i], water_piece_starts[i + 1], water_dots, land_tree_root,
-            height, num_dots, dots, section_progress
-        );
-        exit(0);
+    // Load Checkpoint
 
+    if (resume_phase != 0 && !read_checkpoint_dots(resume_file, context.dots)) {
+        fprintf(stderr, "Couldn't read checkpoint \"%s\".\n", resume_file);
+        return 1;
     }
-    for (int i = 0; i < processes; i++) {
-        waitpid(fork_pids[i], NULL, 0);
-    }
-
-    // Free Water Dots and Land Tree
-
-    free(water_dots);
-    free_recursive(land_tree_root);
 
-    // Add Biome Origin Dots
-    // The area around a biome origin dot will have the same biome
-
-    int biome_origin_indexes[num_dots / 10];
+    CheckpointHeader checkpoint_header = {
+        .magic = "BGDOTS", .version = 1, .dot_size = sizeof(Dot),
+        .width = width, .height = height, .map_resolution = map_resolution,
+        .island_abundance = island_abundance, .island_size = round(island_size * 10),
+        .coastline_smoothing = coastline_smoothing, .seed = config.seed,
+        .num_dots = context.num_dots, .distribution = distribution,
+        .smoothing_method = smoothing_method, .smoothing_passes = smoothing_passes
+    };
 
-    int ii = 0;
-    for (int i = 0; i < num_dots / 10; i++) {
+    int tracker_process_pid = -1;
 
-        // Biome origin dot must be land
-        while (dots[ii].type != 'L') {
-            ii++;
-        }
-        biome_origin_indexes[i] = ii;
+    if (!auto_mode) {
 
-        Dot *dot = &dots[ii];
+        // Progress Tracking
 
-        const float equator_dist = fabs((float)dot->y - height / 2.0) / height * 20.0;
+        tracker_process_pid = fork();
 
-        char probs[10];
-        if (equator_dist < 1) {
-            memcpy(
-                probs, (char[]){'R', 'D', 'D', 'D', 'J', 'J', 'J', 'F', 'F', 'P'}, sizeof(probs)
-            );
-        } else if (equator_dist < 2) {
-            memcpy(
-                probs, (char[]){'R', 'D', 'D', 'D', 'J', 'J', 'F', 'F', 'P', 'P'}, sizeof(probs)
-            );
-        } else if (equator_dist < 3) {
-            memcpy(
-                probs, (char[]){'R', 'D', 'D', 'J', 'F', 'F', 'F', 'P', 'P', 'P'}, sizeof(probs)
-            );
-        } else if (equator_dist < 4) {
-            memcpy(
-                probs, (char[]){'R', 'D', 'J', 'F', 'F', 'F', 'P', 'P', 'P', 'P'}, sizeof(probs)
-            );
-        } else if (equator_dist < 5) {
-            memcpy(
-                probs, (char[]){'R', 'D', 'F', 'F', 'F', 'F', 'P', 'P', 'P', 'P'}, sizeof(probs)
-            );
-        } else if (equator_dist < 6) {
-            memcpy(
-                probs, (char[]){'R', 'F', 'F', 'F', 'F', 'F', 'P', 'P', 'P', 'P'}, sizeof(probs)
-            );
-        } else if (equator_dist < 7) {
-            memcpy(
-                probs, (char[]){'R', 'T', 'F', 'F', 'F', 'F', 'F', 'P', 'P', 'P'}, sizeof(probs)
-            );
-        } else if (equator_dist < 8) {
-            memcpy(
-                probs, (char[]){'R', 'S', 'S', 'T', 'T', 'F', 'F', 'F', 'P', 'P'}, sizeof(probs)
-            );
-        } else if (equator_dist < 9) {
-            memcpy(
-                probs, (char[]){'S', 'S', 'S', 'S', 'T', 'T', 'T', 'T', 'T', 'F'}, sizeof(probs)
+        if (tracker_process_pid == 0) {
+            set_process_title("tracker", -1);
+            track_progress(
+                context.start_time, context.section_progress, context.section_progress_total,
+                context.section_times
             );
-        } else {
-            for (int ii = 0; ii < 10; ii++) {
-                probs[ii] = 'S';
-            }
+            exit(0);
         }
 
-        /*
-        Probability Chart, 1 box = 10% Chance
-        Uppercase/lowercase are an attempt to make it easier to read, they mean nothing
-        This also means s represents snow, not shallow water
-        0-1 | r D D D J J J f f P
-        1-2 | r D D D J J f f P P
-        2-3 | r D D J f f f P P P
-        3-4 | r D J f f f P P P P
-        4-5 | r D f f f f P P P P
-        5-6 | r f f f f f P P P P
-        6-7 | r T f f f f f P P P
-        7-8 | r s s T T f f f P P
-        8-9 | s s s s T T T T f f
-        9-10| s s s s s s s s s s
-        */
-
-        dot->type = probs[rand() % 10];
-
-        ii++;
-
-        atomic_fetch_add(&section_progress[4], 1);
-
-    }
-
-    // Create Land Biomes
-    // Land dots are assigned the biome of the nearest biome origin dot
-
-    // Create Biome Origin KDTree
-
-    int num_biome_dots = num_dots / 10;
-    int *biome_dots = malloc(num_biome_dots * 3 * sizeof(int));
-    for (int i = 0; i < num_biome_dots; i++) {
-        const Dot *dot = &dots[biome_origin_indexes[i]];
-        biome_dots[i * 3] = dot->x;
-        biome_dots[i * 3 + 1] = dot->y;
-        biome_dots[i * 3 + 2] = biome_origin_indexes[i];
-    }
-    Node *biome_tree_root = NULL;
-    biome_tree_root = build_recursive(biome_dots, num_biome_dots, 0);
-    free(biome_dots);
-
-    // Create and Sort Lands
-    // Original "land_dots" was freed in water biome generation
-
-    int num_land_dots2 = 0;
-    int *land_dots2 = malloc(num_dots * 3 * sizeof(int));
-    for (int i = 0; i < num_dots; i++) {
-        const Dot *dot = &dots[i];
-        if (dot->type == 'L') {
-            land_dots2[num_land_dots2 * 3] = dot->x;
-            land_dots2[num_land_dots2 * 3 + 1] = dot->y;
-            land_dots2[num_land_dots2 * 3 + 2] = i;
-            num_land_dots2++;
-        }
     }
 
-    quicksort_recursive(land_dots2, 0, num_land_dots2 - 1, width);
+    // --Map Generation--
+    // Phases after the checkpoint, if any, up to the phase to stop after
 
-    // Create Piece Starts Land Dots
+    for (int phase = resume_phase + 1; phase <= 4 && phase <= stop_phase; phase++) {
 
-    int land_piece_length = num_land_dots2 / processes;
-    int land_piece_starts[processes + 1];
-    for (int i = 0; i < processes; i++) {
-        land_piece_starts[i] = i * land_piece_length;
-    }
-    land_piece_starts[processes] = num_land_dots2;
-
-    // Run Workers
+        // Start Sweep Runs
+        // Everything before this is shared by the runs of a sweep
 
-    for (int i = 0; i < processes; i++) {
-
-        fork_pids[i] = fork();
-        if (fork_pids[i] != 0) {
-            continue;
+        if (phase == sweep_phase) {
+            const int value = start_sweep_run(
+                sweep_first, sweep_last, &context, sweep_phase,
+                output_file, extra_files, num_extra_outputs, checkpoint_files, stats_file
+            );
+            if (sweep_phase == 2) {
+                context.config.island_size = value / 10.0;
+                checkpoint_header.island_size = value;
+            } else {
+                context.config.coastline_smoothing = value;
+                checkpoint_header.coastline_smoothing = value;
+            }
         }
 
-        set_process_title("worker", i);
-        generate_biomes_land(
-            land_piece_starts[i], land_piece_starts[i + 1], land_dots2,
-            biome_tree_root, biome_origin_indexes, num_dots, dots, section_progress
-        );
-        exit(0);
-
-    }
-    for (int i = 0; i < processes; i++) {
-        waitpid(fork_pids[i], NULL, 0);
-    }
-
-    // Free Land Dots and Biome Tree
+        run_phase(&context, phase);
 
-    free(land_dots2);
-    free_recursive(biome_tree_root);
+        // Save Checkpoint
 
-    // Set Section Completion Time
+        write_checkpoint(checkpoint_files[phase], &checkpoint_header, phase, context.dots);
 
-    clock_gettime(CLOCK_REALTIME, &time_now);
-    section_times[4] = (float)(time_now.tv_sec - start_time.tv_sec) +
-        (time_now.tv_nsec - start_time.tv_nsec) / 1000000000.0 - sum_list_float(section_times, 7);
+    }
 
     // --Image Generation--
+    // Workers render bands of rows, which are encoded as soon as they're ready
+    // Skipped, along with the output, when stopping after an earlier phase
 
-    atomic_store(&section_progress_total[5], height);
+    if (stop_phase > 4 && !outputs_cached) {
 
-    // Create Section Starts
+        // Previews
+        /*
+        Previews at 1/8 and then 1/4 of the output's scale are written first,
+        each as soon as it's done, or streamed one after another before the
+        output. Each image's nearest dots seed the searches of the next.
+        */
 
-    const int section_height = height / processes;
+        IndexGrid grids[2];
+        const double output_scale = view.scale;
+        for (int i = 0; preview && i < 2; i++) {
+            char preview_file[229];
+            strncpy(preview_file, output_file, 229);
+            if (strcmp(output_file, "-") != 0) {
+                add_path_suffix(preview_file, (i == 0) ? "_preview8" : "_preview4");
+            }
+            view.scale = output_scale / ((i == 0) ? 8 : 4);
+            render_map(
+                &context, preview_file, output_format, palette, &view,
+                (i == 0) ? NULL : &grids[0], &grids[i], NULL, NULL
+            );
+        }
 
-    int section_starts[processes + 1];
-    for (int i = 0; i < processes; i++) {
-        section_starts[i] = i * section_height;
-    }
-    section_starts[processes] = height;
+        // The main output, then any extra outputs of the same view at other scales
+        for (int i = 0; i <= num_extra_outputs; i++) {
+            view.scale = (i == 0) ? output_scale : extra_scales[i - 1];
+            render_map(
+                &context, (i == 0) ? output_file : extra_files[i - 1], output_format, palette,
+                &view, (i == 0 && preview) ? &grids[1] : NULL, NULL,
+                (i == 0) ? context.type_counts : NULL, NULL
+            );
+        }
 
-    // Create Dots KDTree
+        for (int i = 0; preview && i < 2; i++) {
+            unmap_shared(grids[i].indexes, (size_t)grids[i].width * grids[i].height * sizeof(int));
+        }
 
-    int *dot_coords = malloc(num_dots * 3 * sizeof(int));
-    for (int i = 0; i < num_dots; i++) {
-        const Dot *dot = &dots[i];
-        dot_coords[i * 3] = dot->x;
-        dot_coords[i * 3 + 1] = dot->y;
-        dot_coords[i * 3 + 2] = i;
     }
-    Node *tree_root = NULL;
-    tree_root = build_recursive(dot_coords, num_dots, 0);
-    free(dot_coords);
-
-    // Run Workers
 
-    for (int i = 0; i < processes; i++) {
+    // Write Statistics
+    // From the dots, so they don't depend on the view, or on the image being rendered
 
-        fork_pids[i] = fork();
-        if (fork_pids[i] != 0) {
-            continue;
+    if (stats_file[0] != '\0') {
+        MapStats stats;
+        get_map_stats(&context, &stats);
+        if (!write_stats(stats_file, &context, &stats, stop_phase >= 4)) {
+            fprintf(stderr, "Couldn't write statistics \"%s\".\n", stats_file);
         }
-
-        set_process_title("worker", i);
-        generate_image(
-            section_starts[i], section_starts[i + 1], width, tree_root,
-            num_dots, dots, image_indexes, type_counts, section_progress
-        );
-        exit(0);
-
+        free_map_stats(&stats);
     }
-    for (int i = 0; i < processes; i++) {
-        waitpid(fork_pids[i], NULL, 0);
-    }
-
-    // Free Tree
-
-    free_recursive(tree_root);
-
-    // Set Section Completion Time
 
-    clock_gettime(CLOCK_REALTIME, &time_now);
-    section_times[5] = (float)(time_now.tv_sec - start_time.tv_sec) +
-        (time_now.tv_nsec - start_time.tv_nsec) / 1000000000.0 - sum_list_float(section_times, 7);
-
-    // --Finish--
-
-    atomic_store(&section_progress_total[6], height * 5);
-
-    // Create Image
+    // Add to Cache
+    // Entries are written under a temporary name, then renamed into place
 
-    FILE *fptr = fopen(output_file, "w");
-    png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-    png_infop info_ptr = png_create_info_struct(png_ptr);
+    if (cache_dir[0] != '\0') {
 
-    png_set_IHDR(
-        png_ptr, info_ptr, width, height,
-        8, PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE,
-        PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT
-    );
-
-    // Assign Image Pixels
-
-    png_byte **row_pointers = png_malloc(png_ptr, height * sizeof(png_byte *));
-    for (int y = 0; y < height; y++) {
-        png_byte *row = png_malloc(png_ptr, 3 * sizeof(unsigned char) * width);
-        row_pointers[y] = row;
-        for (int x = 0; x < width; x++) {
-            int rgb[3] = {20, 0, 0};
-            const int image_index = image_indexes[y * width + x];
-            switch (dots[image_index].type) {
-                case 'I':
-                    rgb[0] = 153;
-                    rgb[1] = 221;
-                    rgb[2] = 255;
-                    break;
-                case 's':
-                    rgb[0] = 0;
-                    rgb[1] = 0;
-                    rgb[2] = 255;
-                    break;
-                case 'W':
-                    rgb[0] = 0;
-                    rgb[1] = 0;
-                    rgb[2] = 179;
-                    break;
-                case 'd':
-                    rgb[0] = 0;
-                    rgb[1] = 0;
-                    rgb[2] = 128;
-                    break;
-                case 'R':
-                    rgb[0] = 128;
-                    rgb[1] = 128;
-                    rgb[2] = 128;
-                    break;
-                case 'D':
-                    rgb[0] = 255;
-                    rgb[1] = 185;
-                    rgb[2] = 109;
-                    break;
-                case 'J':
-                    rgb[0] = 0;
-                    rgb[1] = 77;
-                    rgb[2] = 0;
-                    break;
-                case 'F':
-                    rgb[0] = 0;
-                    rgb[1] = 128;
-                    rgb[2] = 0;
-                    break;
-                case 'P':
-                    rgb[0] = 0;
-                    rgb[1] = 179;
-                    rgb[2] = 0;
-                    break;
-                case 'T':
-                    rgb[0] = 152;
-                    rgb[1] = 251;
-                    rgb[2] = 152;
-                    break;
-                case 'S':
-                    rgb[0] = 245;
-                    rgb[1] = 245;
-                    rgb[2] = 245;
-                    break;
-                default:
-                    rgb[0] = 40;
-                    rgb[1] = 0;
-                    rgb[2] = 0;
-                    break;
-            }
-            for (int i = 0; i < 3; i++) {
-                /*
-                Adds slight color variation
-                Every pixel around the same dot has the same variation
-                */
-                int rgb_val = rgb[i];
-                rgb_val += image_index % 20 - 10;
-                if (rgb_val > 255){
-                    rgb_val = 255;
-                } else if (rgb_val < 0) {
-                    rgb_val = 0;
-                }
-                rgb[i] = rgb_val;
+        for (int i = 0; i <= num_extra_outputs && !outputs_cached; i++) {
+            if (i == 0 && strcmp(output_file, "-") == 0) {
+                continue; // Already sent to stdout
             }
-            *row++ = rgb[0];
-            *row++ = rgb[1];
-            *row++ = rgb[2];
+            get_cache_path(cache_dir, output_keys[i], "", cache_path);
+            insert_cached(cache_dir, cache_path, (i == 0) ? output_file : extra_files[i - 1]);
         }
-        atomic_fetch_add(&section_progress[6], 1);
-    }
 
-    // Write Image to File
+        if (resume_phase == 0) {
+            char temp_path[300];
+            snprintf(temp_path, 300, "%s/.temp-%d.dots", cache_dir, getpid());
+            write_checkpoint(temp_path, &checkpoint_header, 4, context.dots);
+            get_cache_path(cache_dir, generation_key, ".dots", cache_path);
+            rename(temp_path, cache_path);
+        }
 
-    png_init_io(png_ptr, fptr);
-    png_set_rows(png_ptr, info_ptr, row_pointers);
-    png_write_png(png_ptr, info_ptr, PNG_TRANSFORM_IDENTITY, NULL);
+        evict_cache(cache_dir, cache_size * 1048576);
 
-    for (int y = 0; y < height; y++) {
-        png_free(png_ptr, row_pointers[y]);
     }
-    png_free(png_ptr, row_pointers);
-
-    fclose(fptr);
-
-    atomic_store(&section_progress[6], height * 5);
 
-    // Set Section Completion Time
+    // Set Completion Time
 
+    struct timespec time_now;
     clock_gettime(CLOCK_REALTIME, &time_now);
-    section_times[6] = (float)(time_now.tv_sec - start_time.tv_sec) +
-        (time_now.tv_nsec - start_time.tv_nsec) / 1000000000.0 - sum_list_float(section_times, 7);
-
-    section_times[7] = (float)(time_now.tv_sec - start_time.tv_sec) +
-        (time_now.tv_nsec - start_time.tv_nsec) / 1000000000.0;
+    context.section_times[7] = (float)(time_now.tv_sec - context.start_time.tv_sec) +
+        (time_now.tv_nsec - context.start_time.tv_nsec) / 1000000000.0;
 
     // Wait for Tracker Process
 
@@ -1805,21 +1151,10 @@ int main(int argc, char *argv[]) {
         waitpid(tracker_process_pid, NULL, 0);
     }
 
-    // Shared Memory Cleanup
-
-    munmap(section_progress, sizeof(int) * 7);
-    munmap(section_progress_total, sizeof(int) * 7);
-    munmap(section_times, sizeof(float) * 8);
-    munmap(dots, sizeof(Dot) * num_dots);
-    munmap(image_indexes, sizeof(int) * width * height);
-
     // Completion
 
-    struct timespec end_time;
-    clock_gettime(CLOCK_REALTIME, &end_time);
     char formatted_time[32];
-    float completion_time = (float)(time_now.tv_sec - start_time.tv_sec) +
-        (time_now.tv_nsec - start_time.tv_nsec) / 1000000000.0;
+    float completion_time = context.section_times[7];
     snprintf(
         formatted_time, 32, "%2d:%08.5f", (int)completion_time / 60, fmod(completion_time, 60.0f)
     );
@@ -1832,15 +1167,16 @@ int main(int argc, char *argv[]) {
             "%sGeneration Complete%s %s\n\nStatistics\n", ANSI_GREEN, ANSI_RESET, formatted_time
         );
 
-        int count_water = 0;
-        int count_land = 0;
+        const long *type_counts = context.type_counts;
+        long count_water = 0;
+        long count_land = 0;
         for (int i = 0; i < 4; i++) {
             count_water += type_counts[i];
         }
         for (int i = 4; i < 11; i++) {
             count_land += type_counts[i];
         }
-        float tot_pct_fact = 100.0 / (height * width); // total percentage factor
+        float tot_pct_fact = 100.0 / ((float)height * width); // total percentage factor
         printf(
             "Water %6.2f%%\nLand  %6.2f%%\n",
             count_water * tot_pct_fact, count_land * tot_pct_fact
@@ -1873,11 +1209,13 @@ int main(int argc, char *argv[]) {
 
     } else {
 
-        printf("%f\n", completion_time);
+        // Keep stdout clean when the image was written there
+        const bool to_stdout = strcmp(output_file, "-") == 0 && stop_phase > 4;
+        fprintf(to_stdout ? stderr : stdout, "%f\n", completion_time);
 
     }
 
-    munmap(type_counts, sizeof(int) * 11);
+    free_context(&context);
 
     return 0;
 